@@ -0,0 +1,3 @@
+bin/core/cmdbuf.o: core/cmdbuf.c core/cmdbuf.h core/util.h
+core/cmdbuf.h:
+core/util.h:
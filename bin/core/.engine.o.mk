@@ -0,0 +1,16 @@
+bin/core/engine.o: core/engine.c core/engine.h plat/glad.h core/util.h \
+ core/math.h core/input.h core/mesh.h core/meshdata.h core/camera.h \
+ core/light.h core/ring_buffer.h core/audio.h core/list.h core/cmdbuf.h
+core/engine.h:
+plat/glad.h:
+core/util.h:
+core/math.h:
+core/input.h:
+core/mesh.h:
+core/meshdata.h:
+core/camera.h:
+core/light.h:
+core/ring_buffer.h:
+core/audio.h:
+core/list.h:
+core/cmdbuf.h:
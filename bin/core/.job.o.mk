@@ -0,0 +1,3 @@
+bin/core/job.o: core/job.c core/job.h core/util.h
+core/job.h:
+core/util.h:
@@ -0,0 +1,3 @@
+bin/core/list.o: core/list.c core/list.h core/util.h
+core/list.h:
+core/util.h:
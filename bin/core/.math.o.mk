@@ -0,0 +1,3 @@
+bin/core/math.o: core/math.c core/util.h core/math.h
+core/util.h:
+core/math.h:
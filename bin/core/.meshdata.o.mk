@@ -0,0 +1,5 @@
+bin/core/meshdata.o: core/meshdata.c core/meshdata.h core/util.h \
+ core/math.h
+core/meshdata.h:
+core/util.h:
+core/math.h:
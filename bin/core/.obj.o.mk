@@ -0,0 +1,4 @@
+bin/core/obj.o: core/obj.c core/math.h core/util.h core/obj.h
+core/math.h:
+core/util.h:
+core/obj.h:
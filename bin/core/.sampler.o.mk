@@ -0,0 +1,8 @@
+bin/core/sampler.o: core/sampler.c core/sampler.h core/audio.h \
+ core/stream.h core/util.h core/ring_buffer.h core/wav.h
+core/sampler.h:
+core/audio.h:
+core/stream.h:
+core/util.h:
+core/ring_buffer.h:
+core/wav.h:
@@ -0,0 +1,5 @@
+bin/core/stream.o: core/stream.c core/stream.h core/util.h \
+ core/ring_buffer.h
+core/stream.h:
+core/util.h:
+core/ring_buffer.h:
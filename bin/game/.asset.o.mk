@@ -0,0 +1,32 @@
+bin/game/asset.o: game/asset.c core/engine.h plat/glad.h core/util.h \
+ core/math.h core/input.h core/mesh.h core/meshdata.h core/camera.h \
+ core/light.h core/ring_buffer.h core/audio.h core/list.h core/cmdbuf.h \
+ core/obj.h game/game.h game/asset.h core/job.h game/render.h \
+ game/entity.h game/gui.h game/sound.h core/sampler.h core/wav.h \
+ core/stream.h game/stb_vorbis.c game/stb_image.h
+core/engine.h:
+plat/glad.h:
+core/util.h:
+core/math.h:
+core/input.h:
+core/mesh.h:
+core/meshdata.h:
+core/camera.h:
+core/light.h:
+core/ring_buffer.h:
+core/audio.h:
+core/list.h:
+core/cmdbuf.h:
+core/obj.h:
+game/game.h:
+game/asset.h:
+core/job.h:
+game/render.h:
+game/entity.h:
+game/gui.h:
+game/sound.h:
+core/sampler.h:
+core/wav.h:
+core/stream.h:
+game/stb_vorbis.c:
+game/stb_image.h:
@@ -0,0 +1,28 @@
+bin/game/game.o: game/game.c game/game.h core/engine.h plat/glad.h \
+ core/util.h core/math.h core/input.h core/mesh.h core/meshdata.h \
+ core/camera.h core/light.h core/ring_buffer.h core/audio.h core/list.h \
+ core/cmdbuf.h game/asset.h core/job.h game/render.h game/entity.h \
+ game/gui.h game/sound.h core/sampler.h core/wav.h game/text.h
+game/game.h:
+core/engine.h:
+plat/glad.h:
+core/util.h:
+core/math.h:
+core/input.h:
+core/mesh.h:
+core/meshdata.h:
+core/camera.h:
+core/light.h:
+core/ring_buffer.h:
+core/audio.h:
+core/list.h:
+core/cmdbuf.h:
+game/asset.h:
+core/job.h:
+game/render.h:
+game/entity.h:
+game/gui.h:
+game/sound.h:
+core/sampler.h:
+core/wav.h:
+game/text.h:
@@ -0,0 +1,8 @@
+bin/game/sound.o: game/sound.c game/sound.h core/sampler.h core/audio.h \
+ core/math.h core/util.h core/wav.h
+game/sound.h:
+core/sampler.h:
+core/audio.h:
+core/math.h:
+core/util.h:
+core/wav.h:
@@ -0,0 +1,2 @@
+bin/game/stb_image_impl.o: game/stb_image_impl.c game/stb_image.h
+game/stb_image.h:
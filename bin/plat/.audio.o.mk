@@ -0,0 +1,6 @@
+bin/plat/audio.o: plat/audio.c plat/core.h core/util.h plat/audio.h \
+ core/ring_buffer.h
+plat/core.h:
+core/util.h:
+plat/audio.h:
+core/ring_buffer.h:
@@ -0,0 +1,4 @@
+bin/plat/core.o: plat/core.c plat/core.h core/util.h plat/pack.h
+plat/core.h:
+core/util.h:
+plat/pack.h:
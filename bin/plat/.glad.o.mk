@@ -0,0 +1,2 @@
+bin/plat/glad.o: plat/glad.c plat/glad.h
+plat/glad.h:
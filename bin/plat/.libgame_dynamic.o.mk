@@ -0,0 +1,30 @@
+bin/plat/libgame_dynamic.o: plat/libgame_dynamic.c plat/libgame.h \
+ game/game.h core/engine.h plat/glad.h core/util.h core/math.h \
+ core/input.h core/mesh.h core/meshdata.h core/camera.h core/light.h \
+ core/ring_buffer.h core/audio.h core/list.h core/cmdbuf.h game/asset.h \
+ game/render.h game/entity.h game/gui.h game/sound.h core/sampler.h \
+ core/wav.h plat/core.h plat/watch.h
+plat/libgame.h:
+game/game.h:
+core/engine.h:
+plat/glad.h:
+core/util.h:
+core/math.h:
+core/input.h:
+core/mesh.h:
+core/meshdata.h:
+core/camera.h:
+core/light.h:
+core/ring_buffer.h:
+core/audio.h:
+core/list.h:
+core/cmdbuf.h:
+game/asset.h:
+game/render.h:
+game/entity.h:
+game/gui.h:
+game/sound.h:
+core/sampler.h:
+core/wav.h:
+plat/core.h:
+plat/watch.h:
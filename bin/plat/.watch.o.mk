@@ -0,0 +1,4 @@
+bin/plat/watch.o: plat/watch.c plat/core.h core/util.h plat/watch.h
+plat/core.h:
+core/util.h:
+plat/watch.h:
@@ -0,0 +1,69 @@
+#include <stddef.h>
+#include "cmdbuf.h"
+
+void
+cmdbuf_init(struct cmdbuf *buf, struct memory_zone *zone, size_t size, size_t capacity)
+{
+	buf->zone = zone;
+	buf->first = NULL;
+	buf->last = NULL;
+	buf->size = size;
+	buf->capacity = capacity;
+	buf->count = 0;
+	buf->lock = 0;
+}
+
+static void
+cmdbuf_grow(struct cmdbuf *buf, struct cmdbuf_chunk *full)
+{
+	struct cmdbuf_chunk *chunk;
+
+	while (__atomic_test_and_set(&buf->lock, __ATOMIC_ACQUIRE))
+		; /* spin, chunk allocation is short */
+
+	/* another producer may already have appended a new chunk */
+	if (buf->last == full) {
+		chunk = mempush(buf->zone, sizeof(*chunk) + buf->capacity * buf->size);
+		chunk->next = NULL;
+		chunk->count = 0;
+		if (full)
+			full->next = chunk;
+		else
+			buf->first = chunk;
+		__atomic_store_n(&buf->last, chunk, __ATOMIC_RELEASE);
+	}
+
+	__atomic_clear(&buf->lock, __ATOMIC_RELEASE);
+}
+
+/* reserve n contiguous elements, n must not exceed the chunk capacity */
+void *
+cmdbuf_reserve(struct cmdbuf *buf, size_t n)
+{
+	struct cmdbuf_chunk *chunk;
+	size_t used;
+
+	if (n > buf->capacity)
+		die("cmdbuf_reserve: %zu elements exceed chunk capacity\n", n);
+
+	for (;;) {
+		chunk = __atomic_load_n(&buf->last, __ATOMIC_ACQUIRE);
+		if (chunk) {
+			used = __atomic_load_n(&chunk->count, __ATOMIC_RELAXED);
+			while (used + n <= buf->capacity) {
+				if (__atomic_compare_exchange_n(&chunk->count, &used, used + n, 1,
+								__ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+					__atomic_fetch_add(&buf->count, n, __ATOMIC_RELAXED);
+					return chunk->data + used * buf->size;
+				}
+			}
+		}
+		cmdbuf_grow(buf, chunk);
+	}
+}
+
+void *
+cmdbuf_push(struct cmdbuf *buf)
+{
+	return cmdbuf_reserve(buf, 1);
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include "util.h"
+
+/* Append-only array of fixed size elements, stored in chunks pushed in a
+ * memory zone. As long as nothing else is pushed in the zone while the
+ * buffer grows, chunks are contiguous and walking the buffer is a linear
+ * read.
+ *
+ * cmdbuf_push() and cmdbuf_reserve() can be called concurrently, but the
+ * buffer must only be read once every producer is done. */
+struct cmdbuf_chunk {
+	struct cmdbuf_chunk *next;
+	size_t count;
+	char data[];
+};
+
+struct cmdbuf {
+	struct memory_zone *zone;
+	struct cmdbuf_chunk *first;
+	struct cmdbuf_chunk *last;
+	size_t size;     /* element size in bytes */
+	size_t capacity; /* elements per chunk */
+	size_t count;
+	unsigned char lock;
+};
+
+void cmdbuf_init(struct cmdbuf *buf, struct memory_zone *zone, size_t size, size_t capacity);
+void *cmdbuf_reserve(struct cmdbuf *buf, size_t n);
+void *cmdbuf_push(struct cmdbuf *buf);
+
+#define cmdbuf_chunk_at(buf, chunk, i) ((void *)((chunk)->data + (i) * (buf)->size))
+
+#define cmdbuf_for_each_chunk(buf, chunk) \
+	for ((chunk) = (buf)->first; (chunk) != NULL; (chunk) = (chunk)->next)
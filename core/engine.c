@@ -1,95 +1,200 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#ifdef _WIN32
+#include <direct.h>
+#define mkdir(path, mode) _mkdir(path)
+#else
+#include <sys/stat.h>
+#endif
 
 #include "engine.h"
 
-static GLint
-shader_compile(GLsizei count, const GLchar **string, const GLint *length, GLenum type, GLuint *out)
+/* linked programs are cached on disk by glGetProgramBinary(), one file
+ * per program name overwritten when its sources or the driver change */
+#define SHADER_CACHE_DIR   "cache"
+#define SHADER_CACHE_MAGIC 0x4e494250 /* "PBIN" */
+
+struct shader_cache_header {
+	uint32_t magic;
+	uint32_t format;
+	uint32_t length;
+	uint32_t pad;
+	uint64_t key;
+};
+
+static const char *shader_uniform_name[SHADER_UNIFORM_COUNT] = {
+	[SHADER_UNIFORM_PROJ] = "proj",
+	[SHADER_UNIFORM_VIEW] = "view",
+	[SHADER_UNIFORM_MODEL] = "model",
+	[SHADER_UNIFORM_TIME] = "time",
+	[SHADER_UNIFORM_CAMP] = "camp",
+	[SHADER_UNIFORM_LIGHTD] = "lightd",
+	[SHADER_UNIFORM_LIGHTC] = "lightc",
+	[SHADER_UNIFORM_LSMAT] = "lsmat",
+	[SHADER_UNIFORM_CASCADE] = "cascade_far",
+	[SHADER_UNIFORM_BIAS] = "cascade_bias",
+	[SHADER_UNIFORM_COLOR] = "color",
+	[SHADER_UNIFORM_RESOLUTION] = "v2Resolution",
+	[SHADER_UNIFORM_THICKNESS] = "thickness",
+	[SHADER_UNIFORM_SHADOWMAP] = "shadowmap",
+	[SHADER_UNIFORM_TEX] = "tex",
+};
+
+static const char *shader_attrib_name[SHADER_ATTRIB_COUNT] = {
+	[SHADER_ATTRIB_POSITION] = "in_pos",
+	[SHADER_ATTRIB_NORMAL] = "in_normal",
+	[SHADER_ATTRIB_TEXCOORD] = "in_texcoord",
+	[SHADER_ATTRIB_MODEL] = "in_model",
+};
+
+static void
+shader_locate(struct shader *s)
 {
-	char logbuf[1024];
-	GLsizei logsize;
-	GLuint shader = glCreateShader(type);
-	GLint ret;
+	int i;
 
-	glShaderSource(shader, count, string, length);
-        glCompileShader(shader);
+	for (i = 0; i < SHADER_UNIFORM_COUNT; i++)
+		s->uniform[i] = glGetUniformLocation(s->prog, shader_uniform_name[i]);
+	for (i = 0; i < SHADER_ATTRIB_COUNT; i++)
+		s->attrib[i] = glGetAttribLocation(s->prog, shader_attrib_name[i]);
+}
 
-	glGetShaderiv(shader, GL_COMPILE_STATUS, &ret);
-	if (ret != GL_TRUE) {
-		glGetShaderInfoLog(shader, sizeof(logbuf), &logsize, logbuf);
-		glDeleteShader(shader);
-		fprintf(stderr, "--- ERROR ---\n%s", logbuf);
-		return ret;
-	}
+static uint64_t
+shader_hash(uint64_t h, const char *str)
+{
+	/* FNV-1a, the terminator keeps "ab" + "c" apart from "a" + "bc" */
+	do {
+		h ^= (unsigned char)*str;
+		h *= 0x100000001b3ull;
+	} while (*str++);
 
-	*out = shader;
-	return GL_TRUE;
+	return h;
 }
 
-GLint
-shader_reload(struct shader *s, const char *vert_src, const char *frag_src, const char *geom_src)
+static int
+shader_cache_supported(void)
 {
-	char logbuf[1024];
-	GLsizei logsize;
-	GLuint prog;
-	GLuint vert = s->vert;
-	GLuint frag = s->frag;
-	GLuint geom = s->geom;
-	GLint vert_len;
-	GLint frag_len;
-	GLint ret;
+	GLint formats = 0;
 
-	if (vert_src) {
-		vert_len = strlen(vert_src);
-		ret = shader_compile(1, &vert_src, &vert_len, GL_VERTEX_SHADER, &vert);
-		if (ret != GL_TRUE)
-			goto err_vert;
-	}
+	if (!glGetProgramBinary || !glProgramBinary || !glProgramParameteri)
+		return 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
 
-	if (frag_src) {
-		frag_len = strlen(frag_src);
-		ret = shader_compile(1, &frag_src, &frag_len, GL_FRAGMENT_SHADER, &frag);
-		if (ret != GL_TRUE)
-			goto err_frag;
-	}
+	return formats > 0;
+}
 
-#ifdef GL_GEOMETRY_SHADER
-	GLint geom_len;
-	if (geom_src) {
-		geom_len = strlen(geom_src);
-		ret = shader_compile(1, &geom_src, &geom_len, GL_GEOMETRY_SHADER, &geom);
-		if (ret != GL_TRUE)
-			goto err_geom;
-	}
-#endif
+/* binaries are only valid for the driver that produced them */
+static uint64_t
+shader_cache_key(const char *vert_src, const char *frag_src, const char *geom_src)
+{
+	uint64_t h = 0xcbf29ce484222325ull;
+	const char *str;
+
+	str = (const char *)glGetString(GL_VENDOR);
+	h = shader_hash(h, str ? str : "");
+	str = (const char *)glGetString(GL_RENDERER);
+	h = shader_hash(h, str ? str : "");
+	str = (const char *)glGetString(GL_VERSION);
+	h = shader_hash(h, str ? str : "");
+	h = shader_hash(h, vert_src);
+	h = shader_hash(h, frag_src);
+	h = shader_hash(h, geom_src ? geom_src : "");
+
+	return h;
+}
+
+static void
+shader_cache_path(char *path, size_t size, uint64_t slot)
+{
+	snprintf(path, size, SHADER_CACHE_DIR "/shader-%016llx.bin", (unsigned long long)slot);
+}
+
+static GLuint
+shader_cache_load(uint64_t slot, uint64_t key)
+{
+	struct shader_cache_header hdr;
+	char path[64];
+	GLuint prog = 0;
+	GLint ret = GL_FALSE;
+	void *binary;
+	long size;
+	FILE *f;
+
+	shader_cache_path(path, sizeof(path), slot);
+	if (!(f = fopen(path, "rb")))
+		return 0;
+	if (fseek(f, 0, SEEK_END) || (size = ftell(f)) < 0 || fseek(f, 0, SEEK_SET))
+		goto err_hdr;
+	if (fread(&hdr, sizeof(hdr), 1, f) != 1 || hdr.magic != SHADER_CACHE_MAGIC || hdr.key != key)
+		goto err_hdr;
+	/* truncated or trailing data, a write that did not finish */
+	if ((unsigned long)size != sizeof(hdr) + hdr.length)
+		goto err_hdr;
+	if (!(binary = malloc(hdr.length)))
+		goto err_hdr;
+	if (fread(binary, hdr.length, 1, f) != 1)
+		goto err_read;
 
-	/* Create a new program */
 	prog = glCreateProgram();
-	if (!prog)
-		goto err_prog;
-	if (vert)
-		glAttachShader(prog, vert);
-	if (frag)
-		glAttachShader(prog, frag);
-	if (geom)
-		glAttachShader(prog, geom);
-
-	glLinkProgram(prog);
+	glProgramBinary(prog, hdr.format, binary, hdr.length);
 	glGetProgramiv(prog, GL_LINK_STATUS, &ret);
+	/* rejected after a driver update, relink from source */
 	if (ret != GL_TRUE) {
-		glGetProgramInfoLog(prog, sizeof(logbuf), &logsize, logbuf);
-		fprintf(stderr, "--- ERROR ---\n%s", logbuf);
-		goto err_link;
+		glDeleteProgram(prog);
+		prog = 0;
 	}
 
+err_read:
+	free(binary);
+err_hdr:
+	fclose(f);
+
+	return prog;
+}
+
+static void
+shader_cache_save(GLuint prog, uint64_t slot, uint64_t key)
+{
+	struct shader_cache_header hdr = { .magic = SHADER_CACHE_MAGIC, .key = key };
+	char path[64];
+	GLint length = 0;
+	GLenum format;
+	void *binary;
+	FILE *f;
+
+	glGetProgramiv(prog, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0 || !(binary = malloc(length)))
+		return;
+	glGetProgramBinary(prog, length, &length, &format, binary);
+	hdr.format = format;
+	hdr.length = length;
+
+	mkdir(SHADER_CACHE_DIR, 0755);
+	shader_cache_path(path, sizeof(path), slot);
+	if ((f = fopen(path, "wb"))) {
+		if (fwrite(&hdr, sizeof(hdr), 1, f) != 1 || fwrite(binary, length, 1, f) != 1)
+			fprintf(stderr, "failed to write %s\n", path);
+		fclose(f);
+	}
+	free(binary);
+}
+
+/* swap in a freshly linked program, the old shaders are kept if reused */
+static void
+shader_replace(struct shader *s, GLuint prog, GLuint vert, GLuint frag, GLuint geom)
+{
 	if (s->prog) {
-		glDetachShader(s->prog, s->vert);
-		glDetachShader(s->prog, s->frag);
-		glDetachShader(s->prog, s->geom);
+		if (s->vert)
+			glDetachShader(s->prog, s->vert);
+		if (s->frag)
+			glDetachShader(s->prog, s->frag);
+		if (s->geom)
+			glDetachShader(s->prog, s->geom);
 		glDeleteProgram(s->prog);
 		if (s->vert != vert)
 			glDeleteShader(s->vert);
-		if (s->vert != frag)
+		if (s->frag != frag)
 			glDeleteShader(s->frag);
 		if (s->geom != geom)
 			glDeleteShader(s->geom);
@@ -97,49 +202,208 @@ shader_reload(struct shader *s, const char *vert_src, const char *frag_src, cons
 	s->prog = prog;
 	s->vert = vert;
 	s->frag = frag;
-	s->frag = geom;
-	return 0;
+	s->geom = geom;
+	shader_locate(s);
+}
 
-err_link:
-	if (vert)
-		glDetachShader(prog, vert);
-	if (frag)
-		glDetachShader(prog, frag);
-	if (geom)
-		glDetachShader(prog, geom);
-	glDeleteProgram(prog);
-err_prog:
-	if (geom_src)
-		glDeleteShader(geom);
-#ifdef GL_GEOMETRY_SHADER
-err_geom:
+/* delete what a failed build created, not the shaders reused from s */
+static void
+shader_discard(const struct shader *s, struct shader_build *b)
+{
+	struct shader *next = &b->next;
+
+	glDeleteProgram(next->prog);
+	if (next->vert != s->vert)
+		glDeleteShader(next->vert);
+	if (next->frag != s->frag)
+		glDeleteShader(next->frag);
+	if (next->geom != s->geom)
+		glDeleteShader(next->geom);
+	memset(b, 0, sizeof(*b));
+}
+
+/* the status is only queried once the build is done, querying it
+ * earlier would wait for the compiler */
+static GLuint
+shader_compile(const GLchar *src, GLenum type)
+{
+	GLuint shader = glCreateShader(type);
+	GLint len = strlen(src);
+
+	glShaderSource(shader, 1, &src, &len);
+	glCompileShader(shader);
+
+	return shader;
+}
+
+static GLint
+shader_check(GLuint old, GLuint shader)
+{
+	char logbuf[1024];
+	GLsizei logsize;
+	GLint ret;
+
+	if (shader == old)
+		return GL_TRUE;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &ret);
+	if (ret != GL_TRUE) {
+		glGetShaderInfoLog(shader, sizeof(logbuf), &logsize, logbuf);
+		fprintf(stderr, "--- ERROR ---\n%s", logbuf);
+	}
+
+	return ret;
+}
+
+/* the driver compiles and links on its own threads */
+int
+shader_parallel(void)
+{
+	return GLAD_GL_KHR_parallel_shader_compile;
+}
+
+/* Start building a program from the given sources without waiting for
+ * the driver, the shaders of s are reused for NULL sources. s keeps
+ * drawing until shader_link(). Programs with a name are cached, one
+ * loaded from the cache has no shaders to reuse and needs every source. */
+GLint
+shader_submit(struct shader_build *b, const struct shader *s, const char *name,
+	      const char *vert_src, const char *frag_src, const char *geom_src)
+{
+	static const struct shader none;
+	struct shader *next = &b->next;
+
+	if (!s)
+		s = &none;
+	memset(b, 0, sizeof(*b));
+	if (s->prog && !s->vert && !s->frag && (!vert_src || !frag_src)) {
+		fprintf(stderr, "%s: cached program, cannot reload a single shader\n", name ? name : "shader");
+		return -1;
+	}
+	next->vert = s->vert;
+	next->frag = s->frag;
+	next->geom = s->geom;
+
+	/* the cache needs every source, a partial reload relinks */
+	b->cache = name && vert_src && frag_src && (geom_src || !s->geom) && shader_cache_supported();
+	if (b->cache) {
+		b->slot = shader_hash(0xcbf29ce484222325ull, name);
+		b->key = shader_cache_key(vert_src, frag_src, geom_src);
+		if ((next->prog = shader_cache_load(b->slot, b->key))) {
+			next->vert = 0;
+			next->frag = 0;
+			next->geom = 0;
+			b->cached = 1;
+			return 0;
+		}
+	}
+
+	if (vert_src)
+		next->vert = shader_compile(vert_src, GL_VERTEX_SHADER);
 	if (frag_src)
-		glDeleteShader(frag);
+		next->frag = shader_compile(frag_src, GL_FRAGMENT_SHADER);
+#ifdef GL_GEOMETRY_SHADER
+	if (geom_src)
+		next->geom = shader_compile(geom_src, GL_GEOMETRY_SHADER);
 #endif
-err_frag:
-	if (vert_src)
-		glDeleteShader(vert);
-err_vert:
 
-	return ret;
+	/* Create a new program */
+	next->prog = glCreateProgram();
+	if (!next->prog) {
+		shader_discard(s, b);
+		return -1;
+	}
+	if (next->vert)
+		glAttachShader(next->prog, next->vert);
+	if (next->frag)
+		glAttachShader(next->prog, next->frag);
+	if (next->geom)
+		glAttachShader(next->prog, next->geom);
+
+	if (b->cache)
+		glProgramParameteri(next->prog, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glLinkProgram(next->prog);
+
+	return 0;
+}
+
+/* return 1 once shader_link() won't wait for the driver, always without
+ * KHR_parallel_shader_compile */
+int
+shader_ready(const struct shader_build *b)
+{
+	GLint done = GL_TRUE;
+
+	if (shader_parallel() && !b->cached)
+		glGetProgramiv(b->next.prog, GL_COMPLETION_STATUS_KHR, &done);
+
+	return done == GL_TRUE;
+}
+
+/* Finish a build and swap it into s, which must be the shader given to
+ * shader_submit() or a zeroed one. On failure s is left untouched. */
+GLint
+shader_link(struct shader *s, struct shader_build *b)
+{
+	struct shader *next = &b->next;
+	char logbuf[1024];
+	GLsizei logsize;
+	GLint ret;
+
+	glGetProgramiv(next->prog, GL_LINK_STATUS, &ret);
+	if (ret != GL_TRUE) {
+		/* print every compile error, the link log only without one */
+		ret = shader_check(s->vert, next->vert) &
+		      shader_check(s->frag, next->frag) &
+		      shader_check(s->geom, next->geom);
+		if (ret == GL_TRUE) {
+			glGetProgramInfoLog(next->prog, sizeof(logbuf), &logsize, logbuf);
+			fprintf(stderr, "--- ERROR ---\n%s", logbuf);
+		}
+		shader_discard(s, b);
+		return -1;
+	}
+	if (b->cache && !b->cached)
+		shader_cache_save(next->prog, b->slot, b->key);
+
+	shader_replace(s, next->prog, next->vert, next->frag, next->geom);
+	memset(b, 0, sizeof(*b));
+
+	return 0;
 }
 
 GLint
-shader_load(struct shader *s, const char *vert_src, const char *frag_src, const char *geom_src)
+shader_reload(struct shader *s, const char *name, const char *vert_src, const char *frag_src, const char *geom_src)
 {
-	return shader_reload(s, vert_src, frag_src, geom_src);
+	struct shader_build b;
+
+	if (shader_submit(&b, s, name, vert_src, frag_src, geom_src))
+		return -1;
+
+	return shader_link(s, &b);
+}
+
+GLint
+shader_load(struct shader *s, const char *name, const char *vert_src, const char *frag_src, const char *geom_src)
+{
+	return shader_reload(s, name, vert_src, frag_src, geom_src);
 }
 
 void
 shader_free(struct shader *s)
 {
-	glDetachShader(s->prog, s->vert);
-	glDetachShader(s->prog, s->frag);
+	if (s->vert)
+		glDetachShader(s->prog, s->vert);
+	if (s->frag)
+		glDetachShader(s->prog, s->frag);
+	if (s->geom)
+		glDetachShader(s->prog, s->geom);
 	glDeleteShader(s->vert);
 	glDeleteShader(s->frag);
+	glDeleteShader(s->geom);
 	glDeleteProgram(s->prog);
 	s->vert = 0;
 	s->frag = 0;
+	s->geom = 0;
 	s->prog = 0;
 }
 
@@ -150,17 +414,21 @@ ray_intersect_mesh(vec3 org, vec3 dir, struct mesh *mesh, mat4 *xfrm)
 	unsigned int i;
 	float dist = 10000.0; /* TODO: find a sane max value */
 	float *pos = mesh->positions;
+	unsigned int *idx = mesh->indices;
+	size_t count = idx ? mesh->index_count : mesh->vertex_count;
 
 	if (!pos)
 		return q;
 	if (mesh->primitive != GL_TRIANGLES)
-		return q; /* not triangulated, need indexes as well */
+		return q; /* not a triangle list */
 
-	for (i = 0; i < mesh->vertex_count; i += 3) {
-		size_t idx = i * 3;
-		vec3 t1 = mat4_mult_vec3(xfrm, (vec3){ pos[idx + 0], pos[idx + 1], pos[idx + 2] });
-		vec3 t2 = mat4_mult_vec3(xfrm, (vec3){ pos[idx + 3], pos[idx + 4], pos[idx + 5] });
-		vec3 t3 = mat4_mult_vec3(xfrm, (vec3){ pos[idx + 6], pos[idx + 7], pos[idx + 8] });
+	for (i = 0; i + 2 < count; i += 3) {
+		size_t a = (idx ? idx[i + 0] : i + 0) * 3;
+		size_t b = (idx ? idx[i + 1] : i + 1) * 3;
+		size_t c = (idx ? idx[i + 2] : i + 2) * 3;
+		vec3 t1 = mat4_mult_vec3(xfrm, (vec3){ pos[a + 0], pos[a + 1], pos[a + 2] });
+		vec3 t2 = mat4_mult_vec3(xfrm, (vec3){ pos[b + 0], pos[b + 1], pos[b + 2] });
+		vec3 t3 = mat4_mult_vec3(xfrm, (vec3){ pos[c + 0], pos[c + 1], pos[c + 2] });
 		vec3 n = vec3_normalize(vec3_cross(vec3_sub(t2, t1), vec3_sub(t3, t1)));
 		vec4 plane = { n.x, n.y, n.z, vec3_dot(t1, n)};
 		float d = ray_distance_to_plane(org, dir, plane);
@@ -198,6 +466,29 @@ create_2d_tex(size_t w, size_t h, GLenum format, GLenum type, void *data)
 	return tex;
 }
 
+/* internal is a sized depth format, ex: GL_DEPTH_COMPONENT24 */
+struct texture
+create_depth_tex(size_t w, size_t h, GLenum internal)
+{
+	struct texture tex;
+
+	tex.type = GL_TEXTURE_2D;
+	tex.width = w;
+	tex.height = h;
+
+	glGenTextures(1, &tex.id);
+	glBindTexture(tex.type, tex.id);
+
+	glTexParameteri(tex.type, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(tex.type, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(tex.type, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(tex.type, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	glTexImage2D(tex.type, 0, internal, w, h, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, NULL);
+
+	return tex;
+}
+
 void
 delete_tex(struct texture *texture)
 {
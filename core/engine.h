@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stddef.h>
+#include <stdint.h>
 #include <math.h>
 
 #include <plat/glad.h>
@@ -14,16 +15,62 @@
 #include "ring_buffer.h"
 #include "audio.h"
 #include "list.h"
+#include "cmdbuf.h"
+
+/* uniforms and attributes known by the engine, their locations are
+ * resolved once when the program is linked */
+enum shader_uniform {
+	SHADER_UNIFORM_PROJ,
+	SHADER_UNIFORM_VIEW,
+	SHADER_UNIFORM_MODEL,
+	SHADER_UNIFORM_TIME,
+	SHADER_UNIFORM_CAMP,
+	SHADER_UNIFORM_LIGHTD,
+	SHADER_UNIFORM_LIGHTC,
+	SHADER_UNIFORM_LSMAT,
+	SHADER_UNIFORM_CASCADE,
+	SHADER_UNIFORM_BIAS,
+	SHADER_UNIFORM_COLOR,
+	SHADER_UNIFORM_RESOLUTION,
+	SHADER_UNIFORM_THICKNESS,
+	SHADER_UNIFORM_SHADOWMAP,
+	SHADER_UNIFORM_TEX,
+	SHADER_UNIFORM_COUNT,
+};
+
+enum shader_attrib {
+	SHADER_ATTRIB_POSITION,
+	SHADER_ATTRIB_NORMAL,
+	SHADER_ATTRIB_TEXCOORD,
+	SHADER_ATTRIB_MODEL,
+	SHADER_ATTRIB_COUNT,
+};
 
 struct shader {
 	GLuint prog;
 	GLuint vert;
 	GLuint frag;
 	GLuint geom;
+	GLint uniform[SHADER_UNIFORM_COUNT];
+	GLint attrib[SHADER_ATTRIB_COUNT];
+};
+
+/* a program being compiled by shader_submit() */
+struct shader_build {
+	struct shader next;
+	uint64_t slot; /* cache file, hash of the program name */
+	uint64_t key; /* program binary cache key */
+	int cache;
+	int cached; /* loaded from the cache, already linked */
 };
-GLint shader_load(struct shader *s, const char *vert, const char *frag, const char *geom);
-GLint shader_reload(struct shader *s, const char *vert, const char *frag, const char *geom);
+GLint shader_load(struct shader *s, const char *name, const char *vert, const char *frag, const char *geom);
+GLint shader_reload(struct shader *s, const char *name, const char *vert, const char *frag, const char *geom);
 void shader_free(struct shader *s);
+int shader_parallel(void);
+GLint shader_submit(struct shader_build *b, const struct shader *s, const char *name,
+		    const char *vert, const char *frag, const char *geom);
+int shader_ready(const struct shader_build *b);
+GLint shader_link(struct shader *s, struct shader_build *b);
 
 vec4 ray_intersect_mesh(vec3 org, vec3 dir, struct mesh *mesh, mat4 *xfrm);
 
@@ -33,6 +80,7 @@ struct texture {
 	size_t width, height;
 };
 struct texture create_2d_tex(size_t w, size_t h, GLenum format, GLenum type, void *data);
+struct texture create_depth_tex(size_t w, size_t h, GLenum internal);
 void delete_tex(struct texture *texture);
 
 struct glyph {
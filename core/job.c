@@ -0,0 +1,107 @@
+#include <unistd.h>
+
+#include "job.h"
+
+#ifdef JOB_THREAD
+static void *
+job_worker(void *arg)
+{
+	struct job_pool *pool = arg;
+	struct job job;
+
+	pthread_mutex_lock(&pool->lock);
+	for (;;) {
+		/* the queue is drained before stopping */
+		while (pool->running && pool->head == pool->tail)
+			pthread_cond_wait(&pool->wake, &pool->lock);
+		if (pool->head == pool->tail)
+			break;
+		job = pool->queue[pool->tail++ % JOB_QUEUE];
+
+		pthread_mutex_unlock(&pool->lock);
+		job.func(job.arg);
+		pthread_mutex_lock(&pool->lock);
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	return NULL;
+}
+
+/* workers started by job_pool_start() */
+static int
+job_workers(void)
+{
+	long cores = 2;
+
+#ifdef _SC_NPROCESSORS_ONLN
+	cores = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+	return MAX(1, MIN(cores - 1, JOB_THREADS));
+}
+#endif
+
+void
+job_pool_start(struct job_pool *pool)
+{
+	if (pool->running)
+		return;
+	pool->head = pool->tail = 0;
+	pool->threads = 0;
+	pool->running = 1;
+#ifdef JOB_THREAD
+	int workers = job_workers();
+
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->wake, NULL);
+	while (pool->threads < workers) {
+		if (pthread_create(&pool->thread[pool->threads], NULL, job_worker, pool))
+			break;
+		pool->threads++;
+	}
+#endif
+}
+
+/* run what is queued and join the workers, the pool can be started again */
+void
+job_pool_stop(struct job_pool *pool)
+{
+	if (!pool->running)
+		return;
+#ifdef JOB_THREAD
+	pthread_mutex_lock(&pool->lock);
+	pool->running = 0;
+	pthread_cond_broadcast(&pool->wake);
+	pthread_mutex_unlock(&pool->lock);
+
+	while (pool->threads > 0)
+		pthread_join(pool->thread[--pool->threads], NULL);
+	pthread_cond_destroy(&pool->wake);
+	pthread_mutex_destroy(&pool->lock);
+#endif
+	pool->running = 0;
+}
+
+/* return 0 if the queue is full */
+int
+job_push(struct job_pool *pool, job_func_t *func, void *arg)
+{
+	if (!pool->threads) {
+		func(arg);
+		return 1;
+	}
+#ifdef JOB_THREAD
+	struct job *job;
+
+	pthread_mutex_lock(&pool->lock);
+	if (pool->head - pool->tail == JOB_QUEUE) {
+		pthread_mutex_unlock(&pool->lock);
+		return 0;
+	}
+	job = &pool->queue[pool->head++ % JOB_QUEUE];
+	job->func = func;
+	job->arg = arg;
+	pthread_cond_signal(&pool->wake);
+	pthread_mutex_unlock(&pool->lock);
+#endif
+	return 1;
+}
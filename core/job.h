@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "util.h"
+
+#ifndef __EMSCRIPTEN__
+#define JOB_THREAD
+#include <pthread.h>
+#endif
+
+/* Small pool of worker threads running queued functions in order of
+ * submission. Without threads, jobs run inline in job_push(). Completion
+ * is signaled by the jobs themselves. */
+
+#define JOB_THREADS 4 /* at most, one core is left to the main thread */
+#define JOB_QUEUE   32
+
+typedef void (job_func_t)(void *arg);
+
+struct job_pool {
+	struct job {
+		job_func_t *func;
+		void *arg;
+	} queue[JOB_QUEUE];
+	size_t head, tail;
+	int running;
+	int threads; /* started workers, 0 runs jobs inline */
+#ifdef JOB_THREAD
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	pthread_t thread[JOB_THREADS];
+#endif
+};
+
+void job_pool_start(struct job_pool *pool);
+void job_pool_stop(struct job_pool *pool);
+int job_push(struct job_pool *pool, job_func_t *func, void *arg);
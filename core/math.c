@@ -1,5 +1,8 @@
 #include <stdio.h>
 #include <string.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 #include "util.h"
 #include "math.h"
 
@@ -314,6 +317,158 @@ sphere_outside_frustum(vec4 planes[6], vec3 center, float radius)
 	return 0;
 }
 
+uint16_t
+float_to_half(float f)
+{
+	union { float f; uint32_t u; } v = { f };
+	uint32_t sign = (v.u >> 16) & 0x8000;
+	int32_t exp = (int32_t)((v.u >> 23) & 0xff) - 127 + 15;
+	uint32_t mant = v.u & 0x7fffff;
+	uint32_t h, rem, half, shift;
+
+	if (((v.u >> 23) & 0xff) == 0xff) /* inf or nan */
+		return sign | 0x7c00 | (mant ? 0x200 : 0);
+	if (exp >= 0x1f)
+		return sign | 0x7c00; /* too big, inf */
+
+	if (exp <= 0) {
+		/* subnormal half, or zero */
+		if (exp < -10)
+			return sign;
+		mant |= 0x800000;
+		shift = 14 - exp;
+	} else {
+		mant |= (uint32_t)exp << 23;
+		shift = 13;
+	}
+
+	h = mant >> shift;
+	rem = mant & ((1u << shift) - 1);
+	half = 1u << (shift - 1);
+	if (rem > half || (rem == half && (h & 1)))
+		h++; /* a carry rounds up to the next exponent */
+
+	return sign | h;
+}
+
+static void
+spheres_in_frustum_scalar(vec4 planes[6], const float *x, const float *y, const float *z,
+			  const float *r, size_t start, size_t count, uint32_t *visible)
+{
+	size_t i;
+	int p;
+
+	for (i = start; i < count; i++) {
+		for (p = 0; p < 6; p++) {
+			vec4 n = planes[p];
+			if (n.x * x[i] + n.y * y[i] + n.z * z[i] + n.w + r[i] < 0)
+				break;
+		}
+		if (p == 6)
+			visible[i / 32] |= 1u << (i % 32);
+	}
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("sse")))
+static void
+spheres_in_frustum_sse(vec4 planes[6], const float *x, const float *y, const float *z,
+		       const float *r, size_t start, size_t count, uint32_t *visible)
+{
+	size_t i;
+	int p;
+
+	for (i = start; i + 4 <= count; i += 4) {
+		__m128 cx = _mm_loadu_ps(x + i);
+		__m128 cy = _mm_loadu_ps(y + i);
+		__m128 cz = _mm_loadu_ps(z + i);
+		__m128 cr = _mm_loadu_ps(r + i);
+		__m128 in = _mm_setzero_ps();
+
+		for (p = 0; p < 6; p++) {
+			__m128 d = _mm_add_ps(cr, _mm_set1_ps(planes[p].w));
+			d = _mm_add_ps(d, _mm_mul_ps(cx, _mm_set1_ps(planes[p].x)));
+			d = _mm_add_ps(d, _mm_mul_ps(cy, _mm_set1_ps(planes[p].y)));
+			d = _mm_add_ps(d, _mm_mul_ps(cz, _mm_set1_ps(planes[p].z)));
+			/* same as the scalar path: outside only when d < 0 */
+			d = _mm_cmpnlt_ps(d, _mm_setzero_ps());
+			in = p ? _mm_and_ps(in, d) : d;
+		}
+		visible[i / 32] |= (uint32_t)_mm_movemask_ps(in) << (i % 32);
+	}
+	spheres_in_frustum_scalar(planes, x, y, z, r, i, count, visible);
+}
+
+__attribute__((target("avx")))
+static void
+spheres_in_frustum_avx(vec4 planes[6], const float *x, const float *y, const float *z,
+		       const float *r, size_t start, size_t count, uint32_t *visible)
+{
+	size_t i;
+	int p;
+
+	for (i = start; i + 8 <= count; i += 8) {
+		__m256 cx = _mm256_loadu_ps(x + i);
+		__m256 cy = _mm256_loadu_ps(y + i);
+		__m256 cz = _mm256_loadu_ps(z + i);
+		__m256 cr = _mm256_loadu_ps(r + i);
+		__m256 in = _mm256_setzero_ps();
+
+		for (p = 0; p < 6; p++) {
+			__m256 d = _mm256_add_ps(cr, _mm256_set1_ps(planes[p].w));
+			d = _mm256_add_ps(d, _mm256_mul_ps(cx, _mm256_set1_ps(planes[p].x)));
+			d = _mm256_add_ps(d, _mm256_mul_ps(cy, _mm256_set1_ps(planes[p].y)));
+			d = _mm256_add_ps(d, _mm256_mul_ps(cz, _mm256_set1_ps(planes[p].z)));
+			d = _mm256_cmp_ps(d, _mm256_setzero_ps(), _CMP_NLT_UQ);
+			in = p ? _mm256_and_ps(in, d) : d;
+		}
+		visible[i / 32] |= (uint32_t)_mm256_movemask_ps(in) << (i % 32);
+	}
+	spheres_in_frustum_scalar(planes, x, y, z, r, i, count, visible);
+}
+#endif
+
+static void (*spheres_in_frustum_impl)(vec4 *, const float *, const float *, const float *,
+				       const float *, size_t, size_t, uint32_t *);
+
+int
+spheres_in_frustum_use(enum frustum_impl impl)
+{
+	switch (impl) {
+	case FRUSTUM_SCALAR:
+		spheres_in_frustum_impl = spheres_in_frustum_scalar;
+		return 1;
+#if defined(__x86_64__) || defined(__i386__)
+	case FRUSTUM_SSE:
+		__builtin_cpu_init();
+		if (!__builtin_cpu_supports("sse"))
+			return 0;
+		spheres_in_frustum_impl = spheres_in_frustum_sse;
+		return 1;
+	case FRUSTUM_AVX:
+		__builtin_cpu_init();
+		if (!__builtin_cpu_supports("avx"))
+			return 0;
+		spheres_in_frustum_impl = spheres_in_frustum_avx;
+		return 1;
+#endif
+	default:
+		return 0;
+	}
+}
+
+void
+spheres_in_frustum(vec4 planes[6], const float *x, const float *y, const float *z,
+		   const float *r, size_t count, uint32_t *visible)
+{
+	if (!spheres_in_frustum_impl && !spheres_in_frustum_use(FRUSTUM_AVX) &&
+	    !spheres_in_frustum_use(FRUSTUM_SSE))
+		spheres_in_frustum_use(FRUSTUM_SCALAR);
+
+	memset(visible, 0, (count + 31) / 32 * sizeof(*visible));
+	spheres_in_frustum_impl(planes, x, y, z, r, 0, count, visible);
+}
+
 void load_rot4(mat4 *d, vec3 axis, float angle) {
 	float s = sin(angle), c = cos(angle), v = 1 - c;
 	float xv, xs, yv, ys, zv, zs;
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <math.h>
+#include <stddef.h>
+#include <stdint.h>
 #include "util.h"
 
 typedef struct vec2_t {
@@ -449,6 +451,34 @@ float plane_signed_distance(vec4 plane, vec3 point);
  */
 int sphere_outside_frustum(vec4 planes[6], vec3 center, float radius);
 
+/* spheres_in_frustum
+   Specification: Take frustrum planes and count spheres given as
+   separate arrays of center x, y, z and radius. Set the bit i of visible
+   when the sphere i intersects the frustum, visible must hold
+   (count + 31) / 32 words.
+   Semantic: batched sphere_outside_frustum, use SSE or AVX when the
+   running CPU has it.
+ */
+void spheres_in_frustum(vec4 planes[6], const float *x, const float *y, const float *z,
+			const float *r, size_t count, uint32_t *visible);
+
+/* spheres_in_frustum_use
+   Semantic: force the implementation used by spheres_in_frustum, for
+   benchmarks. Return 0 when the running CPU lacks it.
+ */
+enum frustum_impl {
+	FRUSTUM_SCALAR,
+	FRUSTUM_SSE,
+	FRUSTUM_AVX,
+};
+int spheres_in_frustum_use(enum frustum_impl impl);
+
+/* float_to_half
+   Semantic: convert a float to an IEEE 754 half precision float, rounded
+   to the nearest even.
+ */
+uint16_t float_to_half(float f);
+
 /* Quaternions and Rotations */
 
 /* print_quaternion
@@ -1,45 +1,6 @@
-#include "engine.h"
-
-static struct bounding_volume
-bounding_volume(size_t count, float *positions)
-{
-	struct bounding_volume bvol = { 0 };
-	float len, max = 0;
-	unsigned int i;
-	vec3 pos;
-
-	if (!positions)
-		return bvol;
-
-	for (i = 0; i < count; i++) {
-		bvol.min.x = MIN(bvol.min.x, positions[i * 3 + 0]);
-		bvol.min.y = MIN(bvol.min.y, positions[i * 3 + 1]);
-		bvol.min.z = MIN(bvol.min.z, positions[i * 3 + 2]);
-		bvol.max.x = MAX(bvol.max.x, positions[i * 3 + 0]);
-		bvol.max.y = MAX(bvol.max.y, positions[i * 3 + 1]);
-		bvol.max.z = MAX(bvol.max.z, positions[i * 3 + 2]);
-	}
+#include <string.h>
 
-	/* full extent from one corner to the other */
-	bvol.ext = vec3_mult(0.5, vec3_sub(bvol.max, bvol.min));
-	/* half extent plus min is the offset from origin to center */
-	bvol.off = vec3_add(bvol.ext, bvol.min);
-
-	for (i = 0; i < count; i++) {
-		pos.x = positions[i * 3 + 0];
-		pos.y = positions[i * 3 + 1];
-		pos.z = positions[i * 3 + 2];
-
-		/* distance to the bounding volume's center */
-		pos = vec3_sub(pos, bvol.off);
-		len = vec3_dot(pos, pos);
-		if (len > max)
-			max = len;
-	}
-	bvol.radius = sqrt(max);
-
-	return bvol;
-}
+#include "engine.h"
 
 static void
 mesh_init_vbo(struct mesh *m, size_t count, GLenum primitive, int positions, int normals, int texcoords)
@@ -48,6 +9,9 @@ mesh_init_vbo(struct mesh *m, size_t count, GLenum primitive, int positions, int
 
 	glGenVertexArrays(1, &m->vao);
 	glBindVertexArray(m->vao);
+	memset(m->vaos, 0, sizeof(m->vaos));
+	m->vao_next = 0;
+	memset(&m->format, 0, sizeof(m->format));
 
 	m->idx_positions = (positions) ? vbo_count++ : 0;
 	m->idx_normals   = (normals)   ? vbo_count++ : 0;
@@ -58,6 +22,8 @@ mesh_init_vbo(struct mesh *m, size_t count, GLenum primitive, int positions, int
 	m->vbo_count = vbo_count;
 	m->vertex_count = count;
 	m->index_count = 0;
+	m->index_type = GL_UNSIGNED_INT;
+	m->indices = NULL;
 
 	m->primitive = primitive;
 }
@@ -85,16 +51,25 @@ mesh_load(struct mesh *m, size_t count, GLenum primitive, float *positions, floa
 
 	glBindVertexArray(0);
 
-	m->bounding = bounding_volume(count, positions);
+	m->bounding = mesh_bounding_volume(count, positions);
 }
 
+/* upload vertices already laid out as described by fmt */
 void
-mesh_index(struct mesh *m, size_t index_count, unsigned int *indices)
+mesh_load_interleaved(struct mesh *m, size_t count, GLenum primitive, const struct mesh_vertex_format *fmt, const void *vertices)
 {
+	mesh_init_vbo(m, count, primitive, 1, 0, 0);
+	m->format = *fmt;
+	m->format.flags |= MESH_INTERLEAVED;
 
-	if (!indices)
-		return;
+	mesh_buffer(m, m->idx_positions, fmt->stride, (void *)vertices, GL_STATIC_DRAW);
+	glBindVertexArray(0);
+}
 
+/* upload indices of size bytes each: 2 or 4 */
+void
+mesh_index_raw(struct mesh *m, size_t index_count, size_t size, const void *indices)
+{
 	m->idx_indices = m->vbo_count++;
 
 	glBindVertexArray(m->vao);
@@ -102,49 +77,136 @@ mesh_index(struct mesh *m, size_t index_count, unsigned int *indices)
 	glGenBuffers(1, &m->vbo[m->idx_indices]);
 
 	m->index_count = index_count;
+	m->index_type = (size == sizeof(uint16_t)) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m->vbo[m->idx_indices]);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, m->index_count * sizeof(unsigned int), indices, GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m->vbo[m->idx_indices]);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_count * size, indices, GL_STATIC_DRAW);
 
 	glBindVertexArray(0);
 }
 
 void
-mesh_bind(struct mesh *m, GLint position, GLint normal, GLint texture)
+mesh_index(struct mesh *m, size_t index_count, unsigned int *indices)
 {
-	glBindVertexArray(m->vao);
+	uint16_t chunk[256];
+	size_t i, j, n;
 
-	if (position >= 0) {
-		glBindBuffer(GL_ARRAY_BUFFER, m->vbo[m->idx_positions]);
-		glVertexAttribPointer(position, 3, GL_FLOAT, GL_FALSE, 0, 0);
-		glEnableVertexAttribArray(position);
-		glVertexAttribDivisor(position, 0);
+	if (!indices)
+		return;
+
+	if (m->vertex_count > 0x10000) {
+		mesh_index_raw(m, index_count, sizeof(unsigned int), indices);
+		return;
 	}
 
-	if (normal >= 0) {
-		glBindBuffer(GL_ARRAY_BUFFER, m->vbo[m->idx_normals]);
-		glVertexAttribPointer(normal, 3, GL_FLOAT, GL_FALSE, 0, 0);
-		glEnableVertexAttribArray(normal);
-		glVertexAttribDivisor(normal, 0);
+	/* narrow to 16 bits by chunks, no need for a scratch buffer */
+	mesh_index_raw(m, index_count, sizeof(uint16_t), NULL);
+	/* element array bindings are vertex array state, use a generic target */
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m->vbo[m->idx_indices]);
+	for (i = 0; i < index_count; i += n) {
+		n = MIN(index_count - i, ARRAY_LEN(chunk));
+		for (j = 0; j < n; j++)
+			chunk[j] = indices[i + j];
+		glBufferSubData(GL_COPY_WRITE_BUFFER, i * sizeof(uint16_t), n * sizeof(uint16_t), chunk);
 	}
+}
 
-	if (texture >= 0) {
+static uint32_t
+mesh_layout_key(struct mesh_layout *l)
+{
+	return (uint32_t)(l->position + 1) << 24 | (uint32_t)(l->normal + 1) << 16 |
+		(uint32_t)(l->texcoord + 1) << 8 | (uint32_t)(l->instance + 1);
+}
+
+/* attribute of the currently bound array buffer */
+static void
+mesh_attrib(GLint loc, GLint size, GLenum type, GLboolean norm, GLsizei stride, size_t off)
+{
+	if (loc < 0)
+		return;
+
+	glVertexAttribPointer(loc, size, type, norm, stride, (void *)off);
+	glEnableVertexAttribArray(loc);
+}
+
+/* Bind the vertex array object matching the layout, it is built on the
+ * first use. Shaders sharing the same locations share the same object,
+ * a reloaded shader with new locations gets a new one. */
+void
+mesh_bind(struct mesh *m, struct mesh_layout *layout)
+{
+	uint32_t key = mesh_layout_key(layout);
+	struct mesh_vao *v;
+	int i;
+
+	for (i = 0; i < MESH_MAX_VAO; i++) {
+		if (m->vaos[i].vao && m->vaos[i].layout == key) {
+			glBindVertexArray(m->vaos[i].vao);
+			return;
+		}
+	}
+
+	/* replace the oldest one */
+	v = &m->vaos[m->vao_next];
+	m->vao_next = (m->vao_next + 1) % MESH_MAX_VAO;
+	if (v->vao)
+		glDeleteVertexArrays(1, &v->vao);
+
+	v->layout = key;
+	glGenVertexArrays(1, &v->vao);
+	glBindVertexArray(v->vao);
+
+	if (m->format.flags & MESH_INTERLEAVED) {
+		GLsizei stride = m->format.stride;
+
+		glBindBuffer(GL_ARRAY_BUFFER, m->vbo[m->idx_positions]);
+		if (m->format.flags & MESH_HALF_POSITION)
+			mesh_attrib(layout->position, 4, GL_HALF_FLOAT, GL_FALSE, stride, 0);
+		else
+			mesh_attrib(layout->position, 3, GL_FLOAT, GL_FALSE, stride, 0);
+		if (m->format.off_normals)
+			mesh_attrib(layout->normal, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, m->format.off_normals);
+		if (m->format.off_texcoords)
+			mesh_attrib(layout->texcoord, 2, GL_HALF_FLOAT, GL_FALSE, stride, m->format.off_texcoords);
+	} else {
+		glBindBuffer(GL_ARRAY_BUFFER, m->vbo[m->idx_positions]);
+		mesh_attrib(layout->position, 3, GL_FLOAT, GL_FALSE, 0, 0);
+		glBindBuffer(GL_ARRAY_BUFFER, m->vbo[m->idx_normals]);
+		mesh_attrib(layout->normal, 3, GL_FLOAT, GL_FALSE, 0, 0);
 		glBindBuffer(GL_ARRAY_BUFFER, m->vbo[m->idx_texcoords]);
-		glVertexAttribPointer(texture, 2, GL_FLOAT, GL_FALSE, 0, 0);
-		glEnableVertexAttribArray(texture);
-		glVertexAttribDivisor(texture, 0);
+		mesh_attrib(layout->texcoord, 2, GL_FLOAT, GL_FALSE, 0, 0);
+	}
+	if (m->index_count > 0)
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m->vbo[m->idx_indices]);
+
+	if (layout->instance >= 0) {
+		glBindBuffer(GL_ARRAY_BUFFER, layout->instance_vbo);
+		/* a mat4 attribute takes 4 consecutive locations, one per column */
+		for (i = 0; i < 4; i++) {
+			glVertexAttribPointer(layout->instance + i, 4, GL_FLOAT, GL_FALSE, sizeof(mat4),
+					      (void *)(i * sizeof(vec4)));
+			glEnableVertexAttribArray(layout->instance + i);
+			glVertexAttribDivisor(layout->instance + i, 1);
+		}
 	}
 }
 
 void
 mesh_free(struct mesh* m)
 {
+	int i;
+
 	if (m->vbo_count)
 		glDeleteBuffers(m->vbo_count, m->vbo);
 	m->vbo_count = 0;
 
 	if (m->vao && glIsVertexArray(m->vao) == GL_TRUE)
 		glDeleteVertexArrays(1, &m->vao);
+
+	for (i = 0; i < MESH_MAX_VAO; i++)
+		if (m->vaos[i].vao)
+			glDeleteVertexArrays(1, &m->vaos[i].vao);
+	memset(m->vaos, 0, sizeof(m->vaos));
 }
 
 void
@@ -1,29 +1,44 @@
 #pragma once
 
+#include "meshdata.h"
+
 #define MESH_ATTRIB_POSITION 0
 #define MESH_ATTRIB_NORMAL   1
 #define MESH_ATTRIB_TEXCOORD 2
 #define MESH_MAX_VBO 4
+#define MESH_MAX_VAO 4
+
+/* attribute locations of a shader, -1 when unused */
+struct mesh_layout {
+	GLint position;
+	GLint normal;
+	GLint texcoord;
+	GLint instance; /* per instance mat4, use 4 consecutive locations */
+	GLuint instance_vbo;
+};
 
 struct mesh {
-	GLuint vao;
+	GLuint vao; /* used while loading buffers */
+	/* vertex array objects built by mesh_bind(), one per layout */
+	struct mesh_vao {
+		uint32_t layout;
+		GLuint vao;
+	} vaos[MESH_MAX_VAO];
+	int vao_next;
 	GLuint vbo[MESH_MAX_VBO];
 	int vbo_count;
+	struct mesh_vertex_format format; /* flags are 0 for separate buffers */
 	int idx_positions;
 	int idx_normals;
 	int idx_texcoords;
 	int idx_indices;
 	size_t vertex_count;
 	size_t index_count;
+	GLenum index_type; /* GL_UNSIGNED_SHORT when vertex_count fits */
 	GLenum primitive;
-	struct bounding_volume {
-		vec3 min;
-		vec3 max;
-		vec3 ext;
-		vec3 off; /* offset to the mesh origin */
-		float radius; /* bounding sphere radius */
-	} bounding;
+	struct bounding_volume bounding;
 	float *positions;
+	unsigned int *indices; /* NULL when not indexed */
 };
 
 /** mesh_load
@@ -49,11 +64,13 @@ struct mesh {
       we assume the values in those data structures are correct.
    Rem:
      coun, positions, normals can be initialized from a wavefront object
-     using load_obj. (see asset.h).
+     using obj_load. (see obj.h).
 */
 void mesh_load(struct mesh *m, size_t count, GLenum primitive, float *positions, float *normals, float *texcoords);
+void mesh_load_interleaved(struct mesh *m, size_t count, GLenum primitive, const struct mesh_vertex_format *fmt, const void *vertices);
 void mesh_index(struct mesh *m, size_t count, unsigned int *index);
-void mesh_bind(struct mesh *m, GLint position, GLint normal, GLint texture);
+void mesh_index_raw(struct mesh *m, size_t count, size_t size, const void *indices);
+void mesh_bind(struct mesh *m, struct mesh_layout *layout);
 void mesh_free(struct mesh *m);
 void mesh_load_box(struct mesh *m, float x, float y, float z);
 void mesh_load_quad(struct mesh *m, float x, float y);
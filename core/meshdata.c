@@ -0,0 +1,278 @@
+#include <string.h>
+
+#include "meshdata.h"
+
+struct bounding_volume
+mesh_bounding_volume(size_t count, const float *positions)
+{
+	struct bounding_volume bvol = { 0 };
+	float len, max = 0;
+	unsigned int i;
+	vec3 pos;
+
+	if (!positions)
+		return bvol;
+
+	for (i = 0; i < count; i++) {
+		bvol.min.x = MIN(bvol.min.x, positions[i * 3 + 0]);
+		bvol.min.y = MIN(bvol.min.y, positions[i * 3 + 1]);
+		bvol.min.z = MIN(bvol.min.z, positions[i * 3 + 2]);
+		bvol.max.x = MAX(bvol.max.x, positions[i * 3 + 0]);
+		bvol.max.y = MAX(bvol.max.y, positions[i * 3 + 1]);
+		bvol.max.z = MAX(bvol.max.z, positions[i * 3 + 2]);
+	}
+
+	/* full extent from one corner to the other */
+	bvol.ext = vec3_mult(0.5, vec3_sub(bvol.max, bvol.min));
+	/* half extent plus min is the offset from origin to center */
+	bvol.off = vec3_add(bvol.ext, bvol.min);
+
+	for (i = 0; i < count; i++) {
+		pos.x = positions[i * 3 + 0];
+		pos.y = positions[i * 3 + 1];
+		pos.z = positions[i * 3 + 2];
+
+		/* distance to the bounding volume's center */
+		pos = vec3_sub(pos, bvol.off);
+		len = vec3_dot(pos, pos);
+		if (len > max)
+			max = len;
+	}
+	bvol.radius = sqrt(max);
+
+	return bvol;
+}
+
+static uint32_t
+pack_snorm_2_10_10_10(float x, float y, float z)
+{
+	int32_t ix = roundf(MAX(-1, MIN(x, 1)) * 511);
+	int32_t iy = roundf(MAX(-1, MIN(y, 1)) * 511);
+	int32_t iz = roundf(MAX(-1, MIN(z, 1)) * 511);
+
+	return (ix & 0x3ff) | (iy & 0x3ff) << 10 | (iz & 0x3ff) << 20;
+}
+
+/* Interleaved layout for the given attributes: float or half positions,
+ * normals as GL_INT_2_10_10_10_REV and half texcoords. Half positions are
+ * padded to 4 components so the attributes stay aligned. */
+struct mesh_vertex_format
+mesh_vertex_format(unsigned int flags, int normals, int texcoords)
+{
+	struct mesh_vertex_format fmt = { 0 };
+
+	fmt.flags = flags | MESH_INTERLEAVED;
+	fmt.stride = (flags & MESH_HALF_POSITION) ? 4 * sizeof(uint16_t) : 3 * sizeof(float);
+	if (normals) {
+		fmt.off_normals = fmt.stride;
+		fmt.stride += sizeof(uint32_t);
+	}
+	if (texcoords) {
+		fmt.off_texcoords = fmt.stride;
+		fmt.stride += 2 * sizeof(uint16_t);
+	}
+
+	return fmt;
+}
+
+/* encode count vertices into out, count * fmt->stride bytes */
+void
+mesh_pack_vertices(const struct mesh_vertex_format *fmt, size_t count, const float *positions,
+		   const float *normals, const float *texcoords, void *out)
+{
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		char *v = (char *)out + i * fmt->stride;
+
+		if (fmt->flags & MESH_HALF_POSITION) {
+			uint16_t p[4] = {
+				float_to_half(positions[i * 3 + 0]),
+				float_to_half(positions[i * 3 + 1]),
+				float_to_half(positions[i * 3 + 2]),
+				float_to_half(1.0),
+			};
+			memcpy(v, p, sizeof(p));
+		} else {
+			memcpy(v, &positions[i * 3], 3 * sizeof(float));
+		}
+		if (fmt->off_normals) {
+			uint32_t n = pack_snorm_2_10_10_10(normals[i * 3 + 0],
+							   normals[i * 3 + 1],
+							   normals[i * 3 + 2]);
+			memcpy(v + fmt->off_normals, &n, sizeof(n));
+		}
+		if (fmt->off_texcoords) {
+			uint16_t t[2] = {
+				float_to_half(texcoords[i * 2 + 0]),
+				float_to_half(texcoords[i * 2 + 1]),
+			};
+			memcpy(v + fmt->off_texcoords, t, sizeof(t));
+		}
+	}
+}
+
+/* next fanning vertex: the candidate still in cache after emitting all its
+ * remaining triangles, else the most recent dead end, else the next live
+ * vertex in input order */
+static long
+tipsify_next(long *cand, size_t cand_count, unsigned int *live, unsigned int *stamp,
+	     unsigned int time, int cache_size, unsigned int *dead, size_t *dead_count,
+	     size_t *cursor, size_t vertex_count)
+{
+	long best = -1;
+	long priority = -1;
+	size_t i;
+
+	for (i = 0; i < cand_count; i++) {
+		long v = cand[i];
+		long p = 0;
+
+		if (!live[v])
+			continue;
+		if (time - stamp[v] + 2 * live[v] <= (unsigned int)cache_size)
+			p = time - stamp[v];
+		if (p > priority) {
+			priority = p;
+			best = v;
+		}
+	}
+	if (best >= 0)
+		return best;
+
+	while (*dead_count > 0) {
+		unsigned int v = dead[--(*dead_count)];
+		if (live[v])
+			return v;
+	}
+	while (*cursor < vertex_count) {
+		if (live[*cursor])
+			return (*cursor)++;
+		(*cursor)++;
+	}
+	return -1;
+}
+
+/* Reorder triangles for the post-transform vertex cache, see "Fast
+ * Triangle Reordering for Vertex Locality and Reduced Overdraw" (Sander,
+ * Nehab, Barczak 2007). indices is a triangle list, rewritten in place. */
+void
+mesh_optimize_index(struct memory_zone *tmp, unsigned int *indices, size_t index_count, size_t vertex_count, int cache_size)
+{
+	struct memory_zone mem_state = *tmp; /* save memory state */
+	size_t tri_count = index_count / 3;
+	size_t i, j, out = 0, cand_count, dead_count = 0, cursor = 0;
+	unsigned int *live, *offset, *adj, *stamp, *dead, *result;
+	unsigned int time = cache_size + 1;
+	unsigned char *emitted;
+	long *cand;
+	long f = 0;
+
+	if (tri_count == 0 || vertex_count == 0)
+		return;
+
+	live    = mempush(tmp, vertex_count * sizeof(*live));
+	offset  = mempush(tmp, (vertex_count + 1) * sizeof(*offset));
+	stamp   = mempush(tmp, vertex_count * sizeof(*stamp));
+	adj     = mempush(tmp, tri_count * 3 * sizeof(*adj));
+	dead    = mempush(tmp, tri_count * 3 * sizeof(*dead));
+	result  = mempush(tmp, tri_count * 3 * sizeof(*result));
+	cand    = mempush(tmp, tri_count * 3 * sizeof(*cand));
+	emitted = mempush(tmp, tri_count * sizeof(*emitted));
+
+	memset(live, 0, vertex_count * sizeof(*live));
+	memset(stamp, 0, vertex_count * sizeof(*stamp));
+	memset(emitted, 0, tri_count * sizeof(*emitted));
+
+	/* vertex to triangles adjacency, offset[v] is the end of v's list
+	 * once filled */
+	for (i = 0; i < tri_count * 3; i++)
+		live[indices[i]]++;
+	offset[0] = 0;
+	for (i = 0; i < vertex_count; i++)
+		offset[i + 1] = offset[i] + live[i];
+	for (i = 0; i < tri_count * 3; i++)
+		adj[offset[indices[i]]++] = i / 3;
+	for (i = vertex_count; i > 0; i--)
+		offset[i] = offset[i - 1];
+	offset[0] = 0;
+
+	while (f >= 0) {
+		cand_count = 0;
+		for (i = offset[f]; i < offset[f + 1]; i++) {
+			unsigned int t = adj[i];
+
+			if (emitted[t])
+				continue;
+			for (j = 0; j < 3; j++) {
+				unsigned int v = indices[t * 3 + j];
+
+				result[out++] = v;
+				dead[dead_count++] = v;
+				cand[cand_count++] = v;
+				live[v]--;
+				if (time - stamp[v] > (unsigned int)cache_size)
+					stamp[v] = time++;
+			}
+			emitted[t] = 1;
+		}
+		f = tipsify_next(cand, cand_count, live, stamp, time, cache_size,
+				 dead, &dead_count, &cursor, vertex_count);
+	}
+	memcpy(indices, result, out * sizeof(*indices));
+
+	/* restore memory zone */
+	*tmp = mem_state;
+}
+
+/* average cache miss ratio: transformed vertices per triangle with a FIFO
+ * cache, 3.0 for unindexed meshes, 0.5 at best on regular grids */
+float
+mesh_acmr(struct memory_zone *tmp, unsigned int *indices, size_t index_count, size_t vertex_count, int cache_size)
+{
+	struct memory_zone mem_state = *tmp; /* save memory state */
+	unsigned int *stamp;
+	unsigned int misses = 0;
+	size_t i;
+
+	if (index_count < 3)
+		return 0;
+
+	/* a vertex is in cache if less than cache_size misses happened
+	 * since it was loaded */
+	stamp = mempush(tmp, vertex_count * sizeof(*stamp));
+	for (i = 0; i < vertex_count; i++)
+		stamp[i] = -cache_size - 1;
+	for (i = 0; i < index_count; i++) {
+		unsigned int v = indices[i];
+
+		if (misses - stamp[v] > (unsigned int)cache_size)
+			stamp[v] = misses++;
+	}
+
+	/* restore memory zone */
+	*tmp = mem_state;
+
+	return misses / (float)(index_count / 3);
+}
+
+/* return 1 if data is a mesh file of this version with blobs in bounds */
+int
+mesh_file_check(const void *data, size_t size)
+{
+	const struct mesh_file_header *hdr = data;
+	uint64_t vsize, isize;
+
+	if (size < sizeof(*hdr) || hdr->magic != MESH_FILE_MAGIC || hdr->version != MESH_FILE_VERSION)
+		return 0;
+	if (!(hdr->format.flags & MESH_INTERLEAVED))
+		return 0;
+	if (hdr->index_size != 0 && hdr->index_size != 2 && hdr->index_size != 4)
+		return 0;
+
+	vsize = (uint64_t)hdr->vertex_count * hdr->format.stride;
+	isize = (uint64_t)hdr->index_count * hdr->index_size;
+
+	return hdr->vertex_offset <= size && vsize <= size - hdr->vertex_offset &&
+		hdr->index_offset <= size && isize <= size - hdr->index_offset;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+/* CPU side mesh processing, no GL calls: also built in tools/ */
+
+#include <stdint.h>
+
+#include "util.h"
+#include "math.h"
+
+/* post-transform cache size targeted by mesh_optimize_index() */
+#define MESH_CACHE_SIZE 16
+
+/* vertex format flags */
+#define MESH_INTERLEAVED   (1 << 0) /* one buffer, packed normals and half uvs */
+#define MESH_HALF_POSITION (1 << 1) /* half positions, imply MESH_INTERLEAVED */
+
+struct bounding_volume {
+	vec3 min;
+	vec3 max;
+	vec3 ext;
+	vec3 off; /* offset to the mesh origin */
+	float radius; /* bounding sphere radius */
+};
+
+/* interleaved vertex layout, see mesh_vertex_format() */
+struct mesh_vertex_format {
+	uint32_t flags;
+	uint32_t stride;
+	uint32_t off_normals; /* 0 without normals */
+	uint32_t off_texcoords; /* 0 without texcoords */
+};
+
+#define MESH_FILE_MAGIC   0x4853454d /* "MESH" */
+#define MESH_FILE_VERSION 1
+
+/* Baked mesh file: this header followed by the vertex and index blobs,
+ * offsets are from the start of the file, native byte order. The vertex
+ * blob is laid out as described by format, ready for upload. */
+struct mesh_file_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t primitive;
+	uint32_t vertex_count;
+	uint32_t index_count;
+	uint32_t index_size; /* 2 or 4 bytes, 0 when not indexed */
+	struct mesh_vertex_format format;
+	struct bounding_volume bounding;
+	uint64_t vertex_offset;
+	uint64_t index_offset;
+};
+
+struct bounding_volume mesh_bounding_volume(size_t count, const float *positions);
+struct mesh_vertex_format mesh_vertex_format(unsigned int flags, int normals, int texcoords);
+void mesh_pack_vertices(const struct mesh_vertex_format *fmt, size_t count, const float *positions,
+			const float *normals, const float *texcoords, void *out);
+void mesh_optimize_index(struct memory_zone *tmp, unsigned int *indices, size_t index_count, size_t vertex_count, int cache_size);
+float mesh_acmr(struct memory_zone *tmp, unsigned int *indices, size_t index_count, size_t vertex_count, int cache_size);
+int mesh_file_check(const void *data, size_t size);
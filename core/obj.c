@@ -0,0 +1,299 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "math.h"
+#include "obj.h"
+
+/* obj indices are 1-based, 0 means absent */
+struct vertex_index {
+	unsigned int p;
+	unsigned int t;
+	unsigned int n;
+};
+
+/* array growing on top of a memory zone, moved to the top when another
+ * allocation was pushed since its last growth */
+struct obj_array {
+	char *data;
+	size_t count;
+	size_t cap;
+	size_t elem;
+	size_t end; /* zone->used after the last growth */
+};
+
+static void *
+obj_array_push(struct memory_zone *zone, struct obj_array *a)
+{
+	if (a->count == a->cap) {
+		size_t cap = a->cap ? a->cap * 2 : 256;
+
+		if (a->data && zone->used == a->end) {
+			mempush(zone, (cap - a->cap) * a->elem);
+		} else {
+			char *data = mempush(zone, cap * a->elem);
+			if (a->count)
+				memcpy(data, a->data, a->count * a->elem);
+			a->data = data;
+		}
+		a->end = zone->used;
+		a->cap = cap;
+	}
+	return a->data + a->count++ * a->elem;
+}
+
+static const char *
+obj_skip_space(const char *s, const char *end)
+{
+	while (s < end && (*s == ' ' || *s == '\t' || *s == '\r'))
+		s++;
+	return s;
+}
+
+static const char *
+obj_skip_line(const char *s, const char *end)
+{
+	while (s < end && *s != '\n')
+		s++;
+	return s < end ? s + 1 : s;
+}
+
+/* decimal float without locale or NUL terminator, exact up to 15
+ * significant digits which is more than exported meshes carry */
+static const char *
+obj_parse_float(const char *s, const char *end, float *out)
+{
+	static const double pow10[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+		1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20,
+		1e21, 1e22,
+	};
+	uint64_t mant = 0;
+	int digits = 0, exp = 0, neg = 0, any = 0;
+	double v;
+
+	if (s < end && (*s == '-' || *s == '+'))
+		neg = *s++ == '-';
+	for (; s < end && *s >= '0' && *s <= '9'; s++, any = 1) {
+		if (digits < 19) {
+			mant = mant * 10 + (*s - '0');
+			digits += mant != 0;
+		} else {
+			exp++;
+		}
+	}
+	if (s < end && *s == '.') {
+		for (s++; s < end && *s >= '0' && *s <= '9'; s++, any = 1) {
+			if (digits < 19) {
+				mant = mant * 10 + (*s - '0');
+				digits += mant != 0;
+				exp--;
+			}
+		}
+	}
+	if (!any)
+		return NULL;
+	if (s < end && (*s == 'e' || *s == 'E')) {
+		const char *e = s + 1;
+		int eneg = 0, ev = 0;
+
+		if (e < end && (*e == '-' || *e == '+'))
+			eneg = *e++ == '-';
+		if (e < end && *e >= '0' && *e <= '9') {
+			for (; e < end && *e >= '0' && *e <= '9'; e++)
+				ev = MIN(ev * 10 + (*e - '0'), 1000);
+			exp += eneg ? -ev : ev;
+			s = e;
+		}
+	}
+
+	v = mant;
+	for (; exp > 22; exp -= 22)
+		v *= pow10[22];
+	for (; exp < -22; exp += 22)
+		v /= pow10[22];
+	v = exp < 0 ? v / pow10[-exp] : v * pow10[exp];
+	*out = neg ? -v : v;
+
+	return s;
+}
+
+static const char *
+obj_parse_int(const char *s, const char *end, long *out)
+{
+	const char *start;
+	long v = 0;
+	int neg = 0;
+
+	if (s < end && (*s == '-' || *s == '+'))
+		neg = *s++ == '-';
+	start = s;
+	for (; s < end && *s >= '0' && *s <= '9'; s++)
+		v = MIN(v * 10 + (*s - '0'), 0x7fffffffL);
+	if (s == start)
+		return NULL;
+	*out = neg ? -v : v;
+
+	return s;
+}
+
+/* 1-based absolute index from an obj index, negative ones are relative to
+ * the end of the list, 0 when out of range */
+static unsigned int
+obj_resolve(long i, size_t count)
+{
+	if (i < 0)
+		i += count + 1;
+	return (i >= 1 && (size_t)i <= count) ? i : 0;
+}
+
+/* a malformed line keeps its slot so later indices still match, zeroed
+ * rather than left with what the zone held */
+static const char *
+obj_parse_floats(const char *s, const char *end, float *out, int count)
+{
+	int i;
+
+	for (i = 0; i < count && s; i++)
+		s = obj_parse_float(obj_skip_space(s, end), end, &out[i]);
+	if (!s)
+		memset(out, 0, count * sizeof(*out));
+	return s;
+}
+
+/* "p", "p/t", "p//n" or "p/t/n", components not given are 0 */
+static const char *
+obj_parse_corner(const char *s, const char *end, struct vertex_index *c,
+		 size_t vcount, size_t tcount, size_t ncount)
+{
+	long p, t = 0, n = 0;
+
+	if (!(s = obj_parse_int(s, end, &p)))
+		return NULL;
+	if (s < end && *s == '/') {
+		s++;
+		if (s < end && *s != '/' && !(s = obj_parse_int(s, end, &t)))
+			return NULL;
+		if (s < end && *s == '/' && !(s = obj_parse_int(s + 1, end, &n)))
+			return NULL;
+	}
+	c->p = obj_resolve(p, vcount);
+	c->t = t ? obj_resolve(t, tcount) : 0;
+	c->n = n ? obj_resolve(n, ncount) : 0;
+	if (!c->p || (t && !c->t) || (n && !c->n))
+		return NULL;
+
+	return s;
+}
+
+
+/* Single pass over a read-only buffer: polygons are fan triangulated,
+ * then identical (p,t,n) corners are welded with an open addressing hash
+ * table. The mesh arrays are pushed on zone after the scratch ones. */
+struct obj_mesh
+obj_load(struct memory_zone *zone, const char *data, size_t size)
+{
+	struct obj_mesh mesh = { 0 };
+	struct obj_array pos = { .elem = sizeof(vec3) };
+	struct obj_array tex = { .elem = sizeof(float) * 2 };
+	struct obj_array nor = { .elem = sizeof(vec3) };
+	struct obj_array tri = { .elem = sizeof(struct vertex_index) };
+	const char *s = data, *end = data + size, *line;
+	struct vertex_index *corners, *keys;
+	unsigned int *table;
+	size_t i, hsize, malformed = 0;
+
+	while (s < end) {
+		line = s = obj_skip_space(s, end);
+		if (s + 1 < end && s[0] == 'v' && (s[1] == ' ' || s[1] == '\t')) {
+			s = obj_parse_floats(s + 1, end, obj_array_push(zone, &pos), 3);
+		} else if (s + 2 < end && s[0] == 'v' && s[1] == 't' && (s[2] == ' ' || s[2] == '\t')) {
+			/* only 2D texture coordinates, w is ignored */
+			s = obj_parse_floats(s + 2, end, obj_array_push(zone, &tex), 2);
+		} else if (s + 2 < end && s[0] == 'v' && s[1] == 'n' && (s[2] == ' ' || s[2] == '\t')) {
+			s = obj_parse_floats(s + 2, end, obj_array_push(zone, &nor), 3);
+		} else if (s + 1 < end && s[0] == 'f' && (s[1] == ' ' || s[1] == '\t')) {
+			struct vertex_index first, prev, c;
+			size_t start = tri.count;
+			int k;
+
+			s++;
+			for (k = 0; s; k++) {
+				s = obj_skip_space(s, end);
+				if (s == end || *s == '\n' || *s == '#')
+					break;
+				s = obj_parse_corner(s, end, &c, pos.count, tex.count, nor.count);
+				if (!s)
+					break;
+				if (k == 0)
+					first = c;
+				if (k >= 2) {
+					struct vertex_index *t = obj_array_push(zone, &tri);
+					t[0] = first;
+					*(struct vertex_index *)obj_array_push(zone, &tri) = prev;
+					*(struct vertex_index *)obj_array_push(zone, &tri) = c;
+				}
+				prev = c;
+			}
+			if (!s || k < 3)
+				tri.count = start; /* drop the whole face */
+		}
+		if (!s) {
+			malformed++;
+			s = line;
+		}
+		s = obj_skip_line(s, end);
+	}
+	if (malformed)
+		fprintf(stderr, "obj_load: skipped %zu malformed lines\n", malformed);
+
+	corners = (struct vertex_index *)tri.data;
+	mesh.index_count = tri.count;
+	if (mesh.index_count == 0)
+		return mesh;
+
+	hsize = 1;
+	while (hsize < mesh.index_count * 2)
+		hsize <<= 1;
+	table = mempush(zone, hsize * sizeof(*table));
+	keys = mempush(zone, mesh.index_count * sizeof(*keys));
+	memset(table, 0, hsize * sizeof(*table));
+
+	/* worst case: no shared vertex */
+	mesh.positions = mempush(zone, mesh.index_count * 3 * sizeof(float));
+	mesh.indices = mempush(zone, mesh.index_count * sizeof(unsigned int));
+	if (nor.count > 0)
+		mesh.normals = mempush(zone, mesh.index_count * 3 * sizeof(float));
+	if (tex.count > 0)
+		mesh.texcoords = mempush(zone, mesh.index_count * 2 * sizeof(float));
+
+	/* table entries are unique vertex ids plus one */
+	for (i = 0; i < mesh.index_count; i++) {
+		struct vertex_index k = corners[i];
+		size_t h = (k.p * 73856093u ^ k.t * 19349663u ^ k.n * 83492791u) & (hsize - 1);
+		size_t v;
+
+		while (table[h]) {
+			struct vertex_index *o = &keys[table[h] - 1];
+			if (o->p == k.p && o->t == k.t && o->n == k.n)
+				break;
+			h = (h + 1) & (hsize - 1);
+		}
+		if (!table[h]) {
+			v = mesh.vertex_count++;
+			keys[v] = k;
+			table[h] = v + 1;
+			memcpy(&mesh.positions[v * 3], pos.data + (k.p - 1) * pos.elem, 3 * sizeof(float));
+			if (mesh.normals && k.n)
+				memcpy(&mesh.normals[v * 3], nor.data + (k.n - 1) * nor.elem, 3 * sizeof(float));
+			else if (mesh.normals)
+				memset(&mesh.normals[v * 3], 0, 3 * sizeof(float));
+			if (mesh.texcoords && k.t)
+				memcpy(&mesh.texcoords[v * 2], tex.data + (k.t - 1) * tex.elem, 2 * sizeof(float));
+			else if (mesh.texcoords)
+				memset(&mesh.texcoords[v * 2], 0, 2 * sizeof(float));
+		}
+		mesh.indices[i] = table[h] - 1;
+	}
+
+	return mesh;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+/* wavefront obj parser, no GL calls: also built in tools/ */
+
+#include <stddef.h>
+
+#include "util.h"
+
+struct obj_mesh {
+	float *positions;
+	float *normals; /* NULL without normals */
+	float *texcoords; /* NULL without texcoords */
+	unsigned int *indices;
+	size_t vertex_count;
+	size_t index_count;
+};
+
+struct obj_mesh obj_load(struct memory_zone *zone, const char *data, size_t size);
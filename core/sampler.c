@@ -1,6 +1,8 @@
 #include <stdint.h>
 #include <stddef.h>
+#include <string.h>
 #include "sampler.h"
+#include "stream.h"
 #include "wav.h"
 
 void
@@ -22,6 +24,20 @@ sampler_init(struct sampler *s, struct wav *wav, int loop, int autoplay)
 	else
 		s->trig = 0;
 	s->vol = 1;
+	if (wav->stream) {
+		wav->stream->loop = s->loop;
+		wav->stream->loop_beg = s->loop_beg;
+	}
+}
+
+/* streams follow the position, other than wrapping into the loop which
+ * their decoder already does */
+static void
+sampler_seek(struct sampler *s, size_t cur)
+{
+	s->cur = cur;
+	if (s->wav->stream)
+		stream_seek(s->wav->stream, cur);
 }
 
 static int
@@ -36,19 +52,38 @@ is_retrigged(struct sampler *s)
 	return (s->trig);
 }
 
-sample
-step_sampler(struct sampler *s)
+/* blocks of fixed size get vectorized at -O2 */
+#define SAMPLER_LANES 8
+
+static void
+sampler_convert(sample *restrict out, const int16_t *restrict in, size_t count, float gain)
+{
+	size_t i, j;
+
+	for (i = 0; i + SAMPLER_LANES <= count; i += SAMPLER_LANES)
+		for (j = 0; j < SAMPLER_LANES; j++)
+			out[i + j] = in[i + j] * gain;
+	for (; i < count; i++)
+		out[i] = in[i] * gain;
+}
+
+/* Render count interleaved samples, the same as as many step_sampler()
+ * calls. Samples are converted in runs up to the end of the buffer or
+ * of what the stream has decoded, a stopped sampler or a stream
+ * underrun renders silence. */
+void
+sampler_render(struct sampler *s, sample *out, size_t count)
 {
-	int16_t *samples;
-	float vol;
-	size_t off;
-	sample ret = 0;
+	size_t nb_samples = s->wav->extras.nb_samples;
+	const int16_t *samples;
+	float gain = s->vol / (float) INT16_MAX;
+	size_t n;
 
 	if (is_retrigged(s)) {
 		s->trig = 0;
 		switch (s->state) {
 			case PLAY:
-				s->cur = s->beg;
+				sampler_seek(s, s->beg);
 				break;
 			case STOP:
 				s->state = PLAY;
@@ -56,25 +91,42 @@ step_sampler(struct sampler *s)
 		}
 	}
 
-	if(pb_fini(s)) {
-		if (s->loop) {
-			s->cur = s->loop_beg;
-		} else {
-			s->state = STOP;
-			s->cur = s->beg;
+	while (count && s->state == PLAY) {
+		if (pb_fini(s)) {
+			if (s->loop) {
+				s->cur = s->loop_beg;
+			} else {
+				s->state = STOP;
+				sampler_seek(s, s->beg);
+				break;
+			}
 		}
-	}
 
-	switch(s->state){
-	case STOP:
-		ret = 0;
-		break;
-	case PLAY:
-		off = s->cur++;
-		vol = s->vol;
-		samples = (int16_t *) s->wav->audio_data;
-		ret = vol * (float) (samples[off] / (float) INT16_MAX);
-		break;
+		n = s->cur < nb_samples ? MIN(count, nb_samples - s->cur) : 0;
+		if (s->wav->stream) {
+			n = stream_peek(s->wav->stream, &samples, n);
+			sampler_convert(out, samples, n, gain);
+			stream_read_done(s->wav->stream, n);
+		} else if (n) {
+			samples = (int16_t *) s->wav->audio_data + s->cur;
+			sampler_convert(out, samples, n, gain);
+		}
+		if (!n)
+			break;
+		s->cur += n;
+		out += n;
+		count -= n;
 	}
+
+	memset(out, 0, count * sizeof(*out));
+}
+
+sample
+step_sampler(struct sampler *s)
+{
+	sample ret;
+
+	sampler_render(s, &ret, 1);
+
 	return ret;
 }
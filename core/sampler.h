@@ -22,3 +22,4 @@ struct sampler {
 
 void sampler_init(struct sampler *s, struct wav *wav, int loop, int trig);
 sample step_sampler(struct sampler *s);
+void sampler_render(struct sampler *s, sample *out, size_t count);
@@ -0,0 +1,154 @@
+#include <time.h>
+
+#include "stream.h"
+
+void
+stream_init(struct stream *s, int channels, stream_decode_t *decode, stream_seek_t *seek, void *ctx)
+{
+	s->ring = ring_buffer_init(s->samples, STREAM_RING_SIZE, sizeof(int16_t));
+	s->channels = channels;
+	s->loop = 1;
+	s->loop_beg = 0;
+	s->seek = 0;
+	s->flush = 0;
+	s->running = 0;
+	s->end = 0;
+	s->decode = decode;
+	s->seek_to = seek;
+	s->ctx = ctx;
+}
+
+/* Return 0 on underrun or while a seek is pending, the caller outputs
+ * silence without moving its position so playback stays sample exact. */
+/* a contiguous run of up to count decoded samples, release them with
+ * stream_read_done() */
+size_t
+stream_peek(struct stream *s, const int16_t **out, size_t count)
+{
+	size_t n;
+
+	if (s->seek)
+		return 0;
+	/* drop what was decoded before the seek, tail is ours to move */
+	if (s->flush) {
+		s->ring.tail = s->flush - 1;
+		s->flush = 0;
+	}
+	n = MIN(count, ring_buffer_read_size(&s->ring));
+	if (!n)
+		return 0;
+
+	/* samples are written before the head moves */
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	*out = ring_buffer_read_addr(&s->ring);
+
+	return n;
+}
+
+void
+stream_read_done(struct stream *s, size_t count)
+{
+	ring_buffer_read_done(&s->ring, count);
+}
+
+int
+stream_read(struct stream *s, int16_t *out)
+{
+	const int16_t *p;
+
+	if (!stream_peek(s, &p, 1))
+		return 0;
+	*out = *p;
+	stream_read_done(s, 1);
+
+	return 1;
+}
+
+void
+stream_seek(struct stream *s, size_t sample)
+{
+	s->seek = sample + 1;
+}
+
+static void
+stream_pump(struct stream *s)
+{
+	size_t seek = s->seek;
+	size_t count, n;
+	int restarted = 0;
+
+	if (seek) {
+		s->seek_to(s->ctx, (seek - 1) / s->channels);
+		s->end = 0;
+		s->flush = s->ring.head + 1;
+		__atomic_thread_fence(__ATOMIC_RELEASE);
+		s->seek = 0;
+	}
+
+	while (!s->end) {
+		/* whole frames only, so a frame is never split by an underrun */
+		count = ring_buffer_write_size(&s->ring);
+		count -= count % s->channels;
+		if (count == 0)
+			break;
+
+		n = s->decode(s->ctx, ring_buffer_write_addr(&s->ring), count);
+		if (n == 0) {
+			/* loop without a gap, give up on an empty stream */
+			if (!s->loop || restarted)
+				s->end = 1;
+			else
+				s->seek_to(s->ctx, s->loop_beg / s->channels);
+			restarted = 1;
+			continue;
+		}
+		restarted = 0;
+
+		__atomic_thread_fence(__ATOMIC_RELEASE);
+		ring_buffer_write_done(&s->ring, n);
+	}
+}
+
+#ifdef STREAM_THREAD
+static void *
+stream_thread(void *arg)
+{
+	struct timespec ts = { 0, 5000000 }; /* 5 ms, far below the ring length */
+	struct stream *s = arg;
+
+	while (s->running) {
+		stream_pump(s);
+		nanosleep(&ts, NULL);
+	}
+
+	return NULL;
+}
+#endif
+
+/* call every frame: start the decoding thread, or decode inline when
+ * threads are not available */
+void
+stream_update(struct stream *s)
+{
+#ifdef STREAM_THREAD
+	if (s->running)
+		return;
+	s->running = 1;
+	if (pthread_create(&s->thread, NULL, stream_thread, s) == 0)
+		return;
+	s->running = 0;
+#endif
+	stream_pump(s);
+}
+
+/* join the decoding thread, the next stream_update() restarts it */
+void
+stream_stop(struct stream *s)
+{
+#ifdef STREAM_THREAD
+	if (!s->running)
+		return;
+	s->running = 0;
+	pthread_join(s->thread, NULL);
+#endif
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "util.h"
+#include "ring_buffer.h"
+
+#ifndef __EMSCRIPTEN__
+#define STREAM_THREAD
+#include <pthread.h>
+#endif
+
+/* Sound decoded ahead into a small ring, by a background thread when
+ * available or by stream_update() otherwise. The consumer reads with
+ * stream_read() or stream_peek() and seeks with stream_seek(), the
+ * decoder is driven through the decode and seek callbacks. */
+
+#define STREAM_RING_SIZE (1 << 16) /* samples, about 0.7 s of 48kHz stereo */
+
+/* decode up to count interleaved samples, return 0 at the end */
+typedef size_t (stream_decode_t)(void *ctx, int16_t *out, size_t count);
+/* move the decoder to a frame, a sample per channel */
+typedef void (stream_seek_t)(void *ctx, size_t frame);
+
+struct stream {
+	struct ring_buffer ring;
+	int16_t samples[STREAM_RING_SIZE];
+	int channels;
+	int loop; /* restart at loop_beg when the decoder ends */
+	size_t loop_beg; /* in samples */
+	volatile size_t seek; /* requested sample plus one, 0 if none */
+	volatile size_t flush; /* ring head after a seek plus one, 0 if none */
+	volatile int running;
+	volatile int end; /* decoder reached the end without looping */
+	stream_decode_t *decode;
+	stream_seek_t *seek_to;
+	void *ctx;
+#ifdef STREAM_THREAD
+	pthread_t thread;
+#endif
+};
+
+void stream_init(struct stream *s, int channels, stream_decode_t *decode, stream_seek_t *seek, void *ctx);
+int stream_read(struct stream *s, int16_t *out);
+size_t stream_peek(struct stream *s, const int16_t **out, size_t count);
+void stream_read_done(struct stream *s, size_t count);
+void stream_seek(struct stream *s, size_t sample);
+void stream_update(struct stream *s);
+void stream_stop(struct stream *s);
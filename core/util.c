@@ -63,3 +63,100 @@ memory_zone_init(void *base, size_t size)
 
 	return zone;
 }
+
+struct memory_block {
+	size_t size; /* usable bytes, after the header */
+	struct memory_block *next; /* when free */
+};
+
+#define BLOCK_HEADER ALIGN(sizeof(struct memory_block), 16)
+#define BLOCK_DATA(b) ((char *)(b) + BLOCK_HEADER)
+#define BLOCK_END(b) (BLOCK_DATA(b) + (b)->size)
+
+struct memory_heap
+memory_heap_init(struct memory_zone *zone)
+{
+	struct memory_heap heap;
+
+	heap.zone = zone;
+	heap.free = NULL;
+	heap.used = 0;
+
+	return heap;
+}
+
+void *
+heap_alloc(struct memory_heap *heap, size_t size)
+{
+	struct memory_block **prev, *b, *rest;
+
+	size = ALIGN(size, 16);
+	for (prev = &heap->free; (b = *prev); prev = &b->next) {
+		if (b->size < size)
+			continue;
+		/* split when the rest can hold another block */
+		if (b->size >= size + 2 * BLOCK_HEADER) {
+			rest = (void *)(BLOCK_DATA(b) + size);
+			rest->size = b->size - size - BLOCK_HEADER;
+			rest->next = b->next;
+			b->size = size;
+			*prev = rest;
+		} else {
+			*prev = b->next;
+		}
+		heap->used += b->size;
+		return BLOCK_DATA(b);
+	}
+
+	b = mempush(heap->zone, BLOCK_HEADER + size);
+	b->size = size;
+	heap->used += size;
+
+	return BLOCK_DATA(b);
+}
+
+/* largest block heap_alloc() can return without dying */
+size_t
+heap_avail(struct memory_heap *heap)
+{
+	struct memory_zone *zone = heap->zone;
+	struct memory_block *b;
+	size_t avail = 0;
+
+	if (zone->size - zone->used > BLOCK_HEADER)
+		avail = zone->size - zone->used - BLOCK_HEADER;
+	for (b = heap->free; b; b = b->next)
+		avail = MAX(avail, b->size);
+
+	return avail & ~(size_t)15;
+}
+
+void
+heap_free(struct memory_heap *heap, void *addr)
+{
+	struct memory_block *b, *before = NULL, *next = heap->free;
+
+	if (!addr)
+		return;
+
+	b = (void *)((char *)addr - BLOCK_HEADER);
+	heap->used -= b->size;
+
+	for (; next && next < b; next = next->next)
+		before = next;
+
+	/* merge with the following then the preceding free block */
+	if (next && BLOCK_END(b) == (char *)next) {
+		b->size += BLOCK_HEADER + next->size;
+		next = next->next;
+	}
+	b->next = next;
+	if (!before) {
+		heap->free = b;
+	} else if (BLOCK_END(before) == (char *)b) {
+		before->size += BLOCK_HEADER + b->size;
+		before->next = next;
+	} else {
+		before->next = b;
+	}
+}
@@ -13,6 +13,7 @@ void die(const char *fmt, ...);
 #define SZ_4M		0x00400000
 #define SZ_8M		0x00800000
 #define SZ_16M		0x01000000
+#define SZ_64M		0x04000000
 #define SZ_256M		0x10000000
 
 struct memory_zone {
@@ -25,3 +26,16 @@ struct memory_zone memory_zone_init(void *base, size_t size);
 void *mempush(struct memory_zone *zone, size_t size);
 void  mempull(struct memory_zone *zone, size_t size);
 
+/* first fit allocator growing inside a zone, for memory freed out of
+ * order: free blocks are kept sorted and merged */
+struct memory_heap {
+	struct memory_zone *zone;
+	struct memory_block *free;
+	size_t used; /* bytes handed out, headers excluded */
+};
+struct memory_heap memory_heap_init(struct memory_zone *zone);
+
+void *heap_alloc(struct memory_heap *heap, size_t size);
+void  heap_free(struct memory_heap *heap, void *addr);
+size_t heap_avail(struct memory_heap *heap);
+
@@ -28,5 +28,6 @@ struct wav{
 	struct header header;
 	struct extras extras;
 	void *audio_data;
+	struct stream *stream; /* decoded on the fly, audio_data is NULL */
 };
 
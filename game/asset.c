@@ -6,9 +6,11 @@
 #include <fcntl.h>
 
 #include "core/engine.h"
+#include "core/obj.h"
 #include "game.h"
 #include "asset.h"
 #include "core/wav.h"
+#include "core/stream.h"
 
 struct asset_file {
 	const char *name;
@@ -17,11 +19,50 @@ struct asset_file {
 	char *data;
 };
 
-struct obj_info {
-	unsigned int vert_count;
-	unsigned int texc_count;
-	unsigned int norm_count;
-	unsigned int face_count;
+/* Loads run in two steps: asset_prepare() reads and decodes the files
+ * on a worker into the job scratch zone, asset_finish() creates the GL
+ * objects on the main thread. */
+struct asset_job {
+	struct game_asset *game_asset;
+	enum asset_key key;
+	int busy;
+	int done; /* set by the worker, atomic */
+	int ok;
+	time_t time;
+	size_t read; /* bytes read or mapped */
+	double decode; /* seconds spent on the worker */
+	double upload; /* main thread seconds before asset_finish() */
+	struct memory_zone zone; /* scratch, emptied by asset_finish() */
+	struct memory_zone scratch; /* ASSET_JOB_ZONE, zone unless larger */
+	union {
+		struct {
+			struct asset_file vert, frag, geom;
+			struct shader_build build;
+			int submitted; /* compiling, see asset_ready() */
+		} shader;
+		struct {
+			struct obj_mesh obj;
+			struct mesh_vertex_format fmt;
+			void *vertices; /* packed, NULL if not */
+			struct bounding_volume bounding;
+			char *file; /* mapped baked mesh, NULL if loaded from obj */
+			size_t size;
+			float acmr_file, acmr; /* before and after reordering */
+		} mesh;
+		struct {
+			unsigned char *pixels;
+			int w, h, n;
+		} png;
+		struct {
+			char *data;
+			size_t size;
+		} wav;
+		struct {
+			struct stb_vorbis *vorbis;
+			char *data;
+			size_t size;
+		} ogg;
+	};
 };
 
 enum res_type {
@@ -29,6 +70,7 @@ enum res_type {
 	SHADER,
 	MESH_INTERNAL,
 	MESH_OBJ,
+	MESH_BIN, /* baked by tools/meshc, src is the obj fallback */
 	SOUND_INTERNAL,
 	SOUND_WAV,
 	SOUND_OGG,
@@ -43,9 +85,12 @@ struct res_entry {
 			const char *vert;
 			const char *frag;
 			const char *geom;
+			enum asset_key depth; /* depth only variant */
 		};
 		struct {
 			const char *file;
+			const char *src;
+			unsigned int flags; /* mesh_vertex_format() flags */
 		};
 	};
 };
@@ -55,13 +100,14 @@ static struct res_entry resfiles[ASSET_KEY_COUNT] = {
 	[DEBUG_MESH_CYLINDER] = { MESH_INTERNAL, {} },
 	[DEBUG_MESH_CUBE] = { MESH_INTERNAL, {} },
 	[MESH_QUAD] = { MESH_INTERNAL, {} },
-	[MESH_FLOOR] = { MESH_OBJ, .file = "res/floor.obj" },
-	[MESH_ROCK_PILAR] = { MESH_OBJ, .file = "res/rock.obj" },
-	[MESH_ROCK_SMALL] = { MESH_OBJ, .file = "res/small.obj" },
-	[SHADER_TEST]  = { SHADER, .vert = "res/proj.vert", .frag = "res/test.frag", },
-	[SHADER_SOLID]  = { SHADER, .vert = "res/proj.vert", .frag = "res/solid.frag", },
+	[MESH_FLOOR] = { MESH_BIN, .file = "res/floor.mesh", .src = "res/floor.obj", .flags = MESH_INTERLEAVED },
+	[MESH_ROCK_PILAR] = { MESH_BIN, .file = "res/rock.mesh", .src = "res/rock.obj", .flags = MESH_INTERLEAVED | MESH_HALF_POSITION },
+	[MESH_ROCK_SMALL] = { MESH_BIN, .file = "res/small.mesh", .src = "res/small.obj", .flags = MESH_INTERLEAVED | MESH_HALF_POSITION },
+	[SHADER_TEST]  = { SHADER, .vert = "res/proj.vert", .frag = "res/test.frag", .depth = SHADER_DEPTH },
+	[SHADER_SOLID]  = { SHADER, .vert = "res/proj.vert", .frag = "res/solid.frag", .depth = SHADER_DEPTH },
 	[SHADER_GUI]  = { SHADER, .vert = "res/gui.vert", .frag = "res/gui.frag", },
 	[SHADER_SKY]  = { SHADER, .vert = "res/sky.vert", .frag = "res/sky.frag", },
+	[SHADER_DEPTH]  = { SHADER, .vert = "res/depth.vert", .frag = "res/depth.frag", },
 	[TEXTURE_GUI_SHAPE]  = { TEXTURE_PNG , .file = "res/ascii.png" },
 
 	//[MESH_TEST]  = { MESH_OBJ, .file = "res/test.obj", },
@@ -70,6 +116,34 @@ static struct res_entry resfiles[ASSET_KEY_COUNT] = {
 	[WAV_CLICK] = { SOUND_WAV, .file = "res/audio/clic.wav" },
 };
 
+/* assets used by each part of the game, loaded ahead of time */
+static const enum asset_key manifest_menu[] = {
+	SHADER_GUI, TEXTURE_GUI_SHAPE, WAV_THEME,
+	/* the menu is drawn over the map */
+	SHADER_TEST, SHADER_DEPTH, SHADER_SKY, MESH_QUAD,
+	MESH_FLOOR, MESH_ROCK_PILAR, MESH_ROCK_SMALL,
+};
+
+static const enum asset_key manifest_play[] = {
+	SHADER_TEST, SHADER_DEPTH, SHADER_SKY, MESH_QUAD,
+	MESH_FLOOR, MESH_ROCK_PILAR, MESH_ROCK_SMALL,
+	SHADER_GUI, TEXTURE_GUI_SHAPE, WAV_THEME, WAV_CLICK,
+};
+
+static const enum asset_key manifest_debug[] = {
+	SHADER_SOLID, DEBUG_SHADER_TEXTURE, DEBUG_MESH_SPHERE,
+	DEBUG_MESH_CROSS, DEBUG_MESH_CUBE, DEBUG_MESH_CYLINDER,
+};
+
+static const struct {
+	const enum asset_key *keys;
+	size_t count;
+} manifests[MANIFEST_COUNT] = {
+	[MANIFEST_MENU] = { manifest_menu, ARRAY_LEN(manifest_menu) },
+	[MANIFEST_PLAY] = { manifest_play, ARRAY_LEN(manifest_play) },
+	[MANIFEST_DEBUG] = { manifest_debug, ARRAY_LEN(manifest_debug) },
+};
+
 struct mesh empty_mesh = { 0 };
 /* default tone for debugging purpose, make it all zeros for a silent sound */
 static int16_t tone[200] = {
@@ -111,34 +185,134 @@ static struct wav silent_wav = {
 	.audio_data = tone,
 };
 
-static int res_file_changed(struct res_entry *res, time_t since);
-static void res_reload_shader(struct game_asset *game_asset, enum asset_key key);
-static void res_reload_mesh_obj(struct game_asset *game_asset, enum asset_key key);
-static void res_reload_wav(struct game_asset *game_asset, enum asset_key key);
-static void res_reload_ogg(struct game_asset *game_asset, enum asset_key key);
-static void res_reload_png(struct game_asset *game_asset, enum asset_key key);
+static int res_uses_file(struct res_entry *res, const char *path);
 static void res_reload_font_meta(struct game_asset *game_asset, enum asset_key key);
 static void init_wav(struct wav *wav, char *obj);
-static struct obj_info read_obj_info(struct asset_file *file);
-static void load_obj(struct memory_zone *zone, struct asset_file *file, struct obj_info info,
-	 size_t count, float *out_vert, float *out_norm, float *out_texc);
 
-static struct res_data
-asset_push_res_data(struct game_asset *game_asset, size_t size)
+/* block of memory owned by an asset version */
+struct asset_block {
+	struct asset_block *next;
+	struct memory_heap *heap;
+	size_t size;
+};
+
+/* memory for the version being built, freed with it */
+static void *
+asset_alloc(struct game_asset *game_asset, struct memory_heap *heap, size_t size)
 {
-	struct res_data res = { };
+	struct asset_block *b;
 
-	res.size = size;
-	res.base = mempush(game_asset->memzone, res.size);
+	b = heap_alloc(heap, sizeof(*b) + size);
+	memset(b + 1, 0, size);
+	b->next = game_asset->building.blocks;
+	b->heap = heap;
+	b->size = size;
+	game_asset->building.blocks = b;
+	game_asset->building.resident += size;
 
-	return res;
+	return b + 1;
 }
 
+/* start a new version, the current one is used until asset_commit() */
 static void *
-asset_push(struct game_asset *game_asset, enum asset_key key, size_t size)
+asset_push(struct game_asset *game_asset, size_t size)
+{
+	game_asset->building.base = asset_alloc(game_asset, &game_asset->heap, size);
+	game_asset->building.size = size;
+
+	return game_asset->building.base;
+}
+
+static void
+asset_free_blocks(struct asset_block *b)
+{
+	struct asset_block *next;
+
+	for (; b; b = next) {
+		next = b->next;
+		heap_free(b->heap, b);
+	}
+}
+
+/* free an old version and its GL objects */
+static void
+asset_release(struct asset_retired *old)
+{
+	switch (resfiles[old->key].type) {
+	case SHADER:
+		shader_free(old->version.base);
+		break;
+	case MESH_INTERNAL:
+	case MESH_OBJ:
+	case MESH_BIN:
+		mesh_free(old->version.base);
+		break;
+	case TEXTURE_PNG:
+		delete_tex(old->version.base);
+		break;
+	default:
+		break;
+	}
+	asset_free_blocks(old->version.blocks);
+}
+
+/* the current version may still be referenced by the frame being built,
+ * it is released a few frames later */
+static void
+asset_retire(struct game_asset *game_asset, enum asset_key key)
+{
+	struct asset_retired *old;
+
+	if (game_asset->retired_count == ASSET_RETIRED) {
+		asset_release(&game_asset->retired[0]);
+		memmove(&game_asset->retired[0], &game_asset->retired[1],
+			(ASSET_RETIRED - 1) * sizeof(game_asset->retired[0]));
+		game_asset->retired_count--;
+	}
+
+	old = &game_asset->retired[game_asset->retired_count++];
+	old->key = key;
+	old->frame = game_asset->frame;
+	old->version = game_asset->assets[key];
+}
+
+/* replace the current version with the one built, or drop it */
+static void
+asset_commit(struct game_asset *game_asset, enum asset_key key, int ok)
+{
+	struct res_data *res = &game_asset->assets[key];
+	struct res_data *new = &game_asset->building;
+
+	if (!ok) {
+		asset_free_blocks(new->blocks);
+	} else if (new->base) {
+		if (res->base)
+			asset_retire(game_asset, key);
+		res->base = new->base;
+		res->size = new->size;
+		res->blocks = new->blocks;
+		res->resident = new->resident;
+	}
+	/* else updated in place */
+
+	new->base = NULL;
+	new->size = 0;
+	new->blocks = NULL;
+	new->resident = 0;
+}
+
+static void
+asset_collect(struct game_asset *game_asset)
 {
-	game_asset->assets[key] = asset_push_res_data(game_asset, size);
-	return game_asset->assets[key].base;
+	size_t i, n = 0;
+
+	for (i = 0; i < game_asset->retired_count; i++) {
+		if (game_asset->frame - game_asset->retired[i].frame >= ASSET_RETIRE_FRAMES)
+			asset_release(&game_asset->retired[i]);
+		else
+			game_asset->retired[n++] = game_asset->retired[i];
+	}
+	game_asset->retired_count = n;
 }
 
 static void
@@ -157,25 +331,11 @@ asset_since(struct game_asset *game_asset, enum asset_key key, time_t new)
 static void
 asset_reload(struct game_asset *game_asset, enum asset_key key)
 {
-	struct res_data *res = &game_asset->assets[key];
 	enum res_type type = resfiles[key].type;
+	struct mesh *mesh;
 
+	/* files are loaded by asset_request() */
 	switch (type) {
-	case SHADER:
-		res_reload_shader(game_asset, key);
-		break;
-	case MESH_OBJ:
-		res_reload_mesh_obj(game_asset, key);
-		break;
-	case SOUND_OGG:
-		res_reload_ogg(game_asset, key);
-		break;
-	case SOUND_WAV:
-		res_reload_wav(game_asset, key);
-		break;
-	case TEXTURE_PNG:
-		res_reload_png(game_asset, key);
-		break;
 	case FONT_CSV:
 		res_reload_font_meta(game_asset, key);
 		break;
@@ -183,28 +343,33 @@ asset_reload(struct game_asset *game_asset, enum asset_key key)
 	case MESH_INTERNAL:
 		switch (key) {
 		case DEBUG_MESH_CYLINDER:
-			*res = asset_push_res_data(game_asset, sizeof(struct mesh));
-			mesh_load_cylinder(res->base, 2, 1, 16);
+			mesh = asset_push(game_asset, sizeof(struct mesh));
+			mesh_load_cylinder(mesh, 2, 1, 16);
+			asset_commit(game_asset, key, 1);
 			asset_state(game_asset, key, STATE_LOADED);
 			break;
 		case DEBUG_MESH_SPHERE:
-			*res = asset_push_res_data(game_asset, sizeof(struct mesh));
-			mesh_load_bounding_sphere(res->base, 1.0);
+			mesh = asset_push(game_asset, sizeof(struct mesh));
+			mesh_load_bounding_sphere(mesh, 1.0);
+			asset_commit(game_asset, key, 1);
 			asset_state(game_asset, key, STATE_LOADED);
 			break;
 		case DEBUG_MESH_CROSS:
-			*res = asset_push_res_data(game_asset, sizeof(struct mesh));
-			mesh_load_cross(res->base, 1.0);
+			mesh = asset_push(game_asset, sizeof(struct mesh));
+			mesh_load_cross(mesh, 1.0);
+			asset_commit(game_asset, key, 1);
 			asset_state(game_asset, key, STATE_LOADED);
 			break;
 		case DEBUG_MESH_CUBE:
-			*res = asset_push_res_data(game_asset, sizeof(struct mesh));
-			mesh_load_box(res->base, 1, 1, 1);
+			mesh = asset_push(game_asset, sizeof(struct mesh));
+			mesh_load_box(mesh, 1, 1, 1);
+			asset_commit(game_asset, key, 1);
 			asset_state(game_asset, key, STATE_LOADED);
 			break;
 		case MESH_QUAD:
-			*res = asset_push_res_data(game_asset, sizeof(struct mesh));
-			mesh_load_quad(res->base, 1, 1);
+			mesh = asset_push(game_asset, sizeof(struct mesh));
+			mesh_load_quad(mesh, 1, 1);
+			asset_commit(game_asset, key, 1);
 			asset_state(game_asset, key, STATE_LOADED);
 			break;
 		default:
@@ -237,83 +402,170 @@ res_load_file(struct memory_zone *zone, const char *filename)
 	return f;
 }
 
+/* the engine constants shaders size their arrays with, inserted after
+ * the #version line, #line keeps the error lines of the file */
 static void
-res_reload_shader(struct game_asset *game_asset, enum asset_key key)
+res_shader_defines(struct memory_zone *zone, struct asset_file *f)
 {
-	struct memory_zone mem_state = game_asset->tmpzone; /* save memory state */
-	struct res_entry *res = &resfiles[key];
-	struct shader *shader;
-	struct asset_file vert = {}, frag = {}, geom = {};
-	time_t time;
-	int ret;
+	char defines[64];
+	char *eol, *data;
+	size_t head, len;
+
+	/* a file without a newline has nothing past its #version */
+	if (!f->data || !(eol = strchr(f->data, '\n')))
+		return;
+	len = snprintf(defines, sizeof(defines), "#define SHADOW_CASCADES %d\n#line 2\n", SHADOW_CASCADES);
+	head = eol - f->data + 1;
+	data = mempush(zone, f->size + len + 1);
+	if (data) {
+		memcpy(data, f->data, head);
+		memcpy(data + head, defines, len);
+		memcpy(data + head + len, f->data + head, f->size - head + 1);
+		f->size += len;
+	}
+	f->data = data;
+}
+
+static void
+res_prepare_shader(struct asset_job *job)
+{
+	struct res_entry *res = &resfiles[job->key];
 
 	if (res->vert)
-		vert = res_load_file(&game_asset->tmpzone, res->vert);
+		job->shader.vert = res_load_file(&job->zone, res->vert);
 	if (res->frag)
-		frag = res_load_file(&game_asset->tmpzone, res->frag);
+		job->shader.frag = res_load_file(&job->zone, res->frag);
 	if (res->geom)
-		geom = res_load_file(&game_asset->tmpzone, res->geom);
+		job->shader.geom = res_load_file(&job->zone, res->geom);
 
+	job->read = MAX(job->shader.vert.size, 0) + MAX(job->shader.frag.size, 0) + MAX(job->shader.geom.size, 0);
+	res_shader_defines(&job->zone, &job->shader.vert);
+	res_shader_defines(&job->zone, &job->shader.frag);
+	res_shader_defines(&job->zone, &job->shader.geom);
 	/* not a valid shader */
-	if (!vert.data || !frag.data)
-		goto out;
-
-	time = MAX(vert.time, frag.time);
-	time = MAX(time, geom.time);
+	job->ok = job->shader.vert.data && job->shader.frag.data;
+	job->time = MAX(job->shader.vert.time, job->shader.frag.time);
+	job->time = MAX(job->time, job->shader.geom.time);
+}
 
-	shader = asset_push(game_asset, key, sizeof(struct shader));
+static int
+res_finish_shader(struct game_asset *game_asset, struct asset_job *job)
+{
+	struct shader *shader;
+	char *vert = job->shader.vert.data;
+	char *frag = job->shader.frag.data;
 
-	ret = shader_reload(shader, vert.data, frag.data, geom.data);
-	if (ret) {
-		printf("failed to reload shader: %s %s\n", vert.data, frag.data);
-		asset_state(game_asset, key, STATE_UNLOAD);
-	} else {
-		asset_since(game_asset, key, time);
-		asset_state(game_asset, key, STATE_LOADED);
+	shader = asset_push(game_asset, sizeof(struct shader));
+	if (shader_link(shader, &job->shader.build)) {
+		printf("failed to reload shader: %s %s\n", vert, frag);
+		return 0;
 	}
-out:
-	/* restore memory zone */
-	game_asset->tmpzone = mem_state;
+
+	return 1;
 }
 
 static void
-res_reload_mesh_obj(struct game_asset *game_asset, enum asset_key key)
+res_prepare_mesh_obj(struct asset_job *job, const char *path)
 {
-	struct memory_zone mem_state = game_asset->tmpzone; /* save memory state */
-	struct res_entry *res = &resfiles[key];
-	struct mesh *mesh;
+	struct res_entry *res = &resfiles[job->key];
+	struct obj_mesh *obj = &job->mesh.obj;
 	struct asset_file file;
-	struct obj_info info;
-	float *positions;
-	float *normals;
-	float *texcoords;
-	size_t fcount;
+	int64_t size;
+
+	/* the zone is sized by asset_request(), a baked mesh found invalid
+	 * only now falls back here with the default one */
+	size = io.file_size(path);
+	if (size > 0 && ASSET_OBJ_ZONE((size_t)size) > job->zone.size - job->zone.used) {
+		warn("%s: too large to parse in %zu bytes, bake it with meshc\n", path, job->zone.size);
+		return;
+	}
 
-	file = res_load_file(&game_asset->tmpzone, res->file);
-	if (file.data) {
-		info = read_obj_info(&file);
+	file = res_load_file(&job->zone, path);
+	if (!file.data)
+		return;
+	job->read += file.size;
+	*obj = obj_load(&job->zone, file.data, file.size);
+	if (obj->index_count == 0)
+		return;
+
+	job->mesh.acmr_file = mesh_acmr(&job->zone, obj->indices, obj->index_count, obj->vertex_count, MESH_CACHE_SIZE);
+	mesh_optimize_index(&job->zone, obj->indices, obj->index_count, obj->vertex_count, MESH_CACHE_SIZE);
+	job->mesh.acmr = mesh_acmr(&job->zone, obj->indices, obj->index_count, obj->vertex_count, MESH_CACHE_SIZE);
+
+	if (res->flags) {
+		job->mesh.fmt = mesh_vertex_format(res->flags, obj->normals != NULL, obj->texcoords != NULL);
+		job->mesh.vertices = mempush(&job->zone, obj->vertex_count * job->mesh.fmt.stride);
+		mesh_pack_vertices(&job->mesh.fmt, obj->vertex_count, obj->positions,
+				   obj->normals, obj->texcoords, job->mesh.vertices);
+		job->mesh.bounding = mesh_bounding_volume(obj->vertex_count, obj->positions);
+	}
+
+	job->time = file.time;
+	job->ok = 1;
+}
+
+/* baked meshes are uploaded straight from the mapped file, they keep no
+ * cpu side copy */
+static void
+res_prepare_mesh_bin(struct asset_job *job)
+{
+	struct res_entry *res = &resfiles[job->key];
+	char *data = NULL;
+	size_t size = 0;
+
+	job->time = io.file_time(res->file);
+	if (job->time >= io.file_time(res->src))
+		data = io.file_map(res->file, &size);
+	if (data && !mesh_file_check(data, size)) {
+		warn("%s: invalid mesh file\n", res->file);
+		io.file_unmap(data, size);
+		data = NULL;
+	}
+	if (!data) {
+		/* missing or older than its source */
+		res_prepare_mesh_obj(job, res->src);
+		return;
+	}
 
-		fcount = info.face_count;
-		/* keep positions outside of scrap/tmp zone */
-		positions = mempush(&game_asset->tmpzone, fcount * 3 * 3 * sizeof(float));
-		normals   = mempush(&game_asset->tmpzone, fcount * 3 * 3 * sizeof(float));
-		texcoords = NULL;
-		if (info.texc_count > 0)
-			texcoords = mempush(&game_asset->tmpzone, fcount * 3 * 2 * sizeof(float));
+	job->mesh.file = data;
+	job->mesh.size = size;
+	job->read = size;
+	job->ok = 1;
+}
 
-		load_obj(&game_asset->tmpzone, &file, info, fcount, positions, normals, texcoords);
+static int
+res_finish_mesh(struct game_asset *game_asset, struct asset_job *job)
+{
+	const struct mesh_file_header *hdr = (void *)job->mesh.file;
+	struct obj_mesh *obj = &job->mesh.obj;
+	struct mesh *mesh;
 
-		mesh = asset_push(game_asset, key, sizeof(struct mesh));
-		/* for now mesh are triangulates: no index list */
-		mesh_load(mesh, fcount * 3, GL_TRIANGLES, positions, normals, texcoords);
-		mesh->positions = positions;
+	mesh = asset_push(game_asset, sizeof(struct mesh));
+	if (hdr) {
+		mesh_load_interleaved(mesh, hdr->vertex_count, hdr->primitive, &hdr->format,
+				      job->mesh.file + hdr->vertex_offset);
+		if (hdr->index_size)
+			mesh_index_raw(mesh, hdr->index_count, hdr->index_size, job->mesh.file + hdr->index_offset);
+		mesh->bounding = hdr->bounding;
+		io.file_unmap(job->mesh.file, job->mesh.size);
+		return 1;
+	}
 
-		asset_since(game_asset, key, file.time);
-		asset_state(game_asset, key, STATE_LOADED);
+	if (job->mesh.vertices) {
+		mesh_load_interleaved(mesh, obj->vertex_count, GL_TRIANGLES, &job->mesh.fmt, job->mesh.vertices);
+		mesh->bounding = job->mesh.bounding;
+	} else {
+		mesh_load(mesh, obj->vertex_count, GL_TRIANGLES, obj->positions, obj->normals, obj->texcoords);
 	}
+	mesh_index(mesh, obj->index_count, obj->indices);
 
-	/* restore memory zone */
-	game_asset->tmpzone = mem_state;
+	/* keep a copy for cpu side queries, the job zone is emptied */
+	mesh->positions = asset_alloc(game_asset, &game_asset->heap, obj->vertex_count * 3 * sizeof(float));
+	mesh->indices = asset_alloc(game_asset, &game_asset->heap, obj->index_count * sizeof(unsigned int));
+	memcpy(mesh->positions, obj->positions, obj->vertex_count * 3 * sizeof(float));
+	memcpy(mesh->indices, obj->indices, obj->index_count * sizeof(unsigned int));
+
+	return 1;
 }
 
 static void
@@ -335,7 +587,7 @@ res_reload_font_meta(struct game_asset *game_asset, enum asset_key key)
 	file = res_load_file(mem, res->file);
 	glyph_count = 0;
 	if (file.data) {
-		meta = asset_push(game_asset, key, sizeof(struct font_meta));
+		meta = asset_push(game_asset, sizeof(struct font_meta));
 		/* count the number of lines/glyphs */
 		for (i = 0; i < file.size; i += len) {
 			line = &file.data[i];
@@ -366,117 +618,504 @@ res_reload_font_meta(struct game_asset *game_asset, enum asset_key key)
 
 		meta->glyph_count = glyph_count;
 
+		asset_commit(game_asset, key, 1);
 		asset_since(game_asset, key, file.time);
 		asset_state(game_asset, key, STATE_LOADED);
 	}
 	*mem = mem_state;
 }
 
+/* mapped on the worker, copied to the samples zone on the main thread */
 static void
-res_reload_wav(struct game_asset *game_asset, enum asset_key key)
+res_prepare_wav(struct asset_job *job)
+{
+	struct res_entry *res = &resfiles[job->key];
+
+	job->wav.data = io.file_map(res->file, &job->wav.size);
+	job->read = job->wav.size;
+	job->time = io.file_time(res->file);
+	job->ok = job->wav.data != NULL;
+}
+
+static int
+res_finish_wav(struct game_asset *game_asset, struct asset_job *job)
 {
 	struct wav *wav;
-	struct res_entry *res = &resfiles[key];
-	struct asset_file file;
+	char *data;
 
-	file = res_load_file(game_asset->samples, res->file);
-	if (file.data) {
-		wav = asset_push(game_asset, key, sizeof(struct wav));
-		init_wav(wav, file.data);
-		asset_since(game_asset, key, file.time);
-		asset_state(game_asset, key, STATE_LOADED);
-	}
+	data = asset_alloc(game_asset, &game_asset->sample_heap, job->wav.size);
+	memcpy(data, job->wav.data, job->wav.size);
+	io.file_unmap(job->wav.data, job->wav.size);
+
+	wav = asset_push(game_asset, sizeof(struct wav));
+	init_wav(wav, data);
+
+	return 1;
 }
 
 #include "stb_vorbis.c"
 
+/* streamed ogg: the file stays mapped and is decoded by a stream */
+struct ogg_stream {
+	struct wav wav; /* first, the asset is used as a wav */
+	struct stream stream;
+	stb_vorbis *vorbis;
+	void *data;
+	size_t size;
+};
+
+static size_t
+ogg_decode(void *ctx, int16_t *out, size_t count)
+{
+	struct ogg_stream *ogg = ctx;
+	int channels = ogg->stream.channels;
+
+	return channels * stb_vorbis_get_samples_short_interleaved(ogg->vorbis, channels, out, count);
+}
+
 static void
-res_reload_ogg(struct game_asset *game_asset, enum asset_key key)
+ogg_seek(void *ctx, size_t frame)
 {
-	struct memory_zone mem_state = *game_asset->samples;
-	struct wav *wav;
-	struct res_entry *res = &resfiles[key];
-	struct asset_file file;
-	int channels, samplerate, frames;
-	int16_t *output;
+	struct ogg_stream *ogg = ctx;
 
-	file = res_load_file(game_asset->samples, res->file);
-	if (file.data) {
-		unsigned char *data = (unsigned char *)file.data;
-		frames = stb_vorbis_decode_memory(data, file.size, &channels, &samplerate, &output);
-		wav = asset_push(game_asset, key, sizeof(struct wav));
-		wav->extras.samplesize = sizeof(uint16_t);
-		wav->extras.nb_frames = frames;
-		wav->extras.nb_samples = frames * channels;
-		wav->header.channels = channels;
-		wav->audio_data = output;
+	if (frame == 0)
+		stb_vorbis_seek_start(ogg->vorbis);
+	else
+		stb_vorbis_seek(ogg->vorbis, frame);
+}
 
-		asset_since(game_asset, key, file.time);
-		asset_state(game_asset, key, STATE_LOADED);
+static void
+ogg_close(struct ogg_stream *ogg)
+{
+	stream_stop(&ogg->stream);
+	stb_vorbis_close(ogg->vorbis);
+	io.file_unmap(ogg->data, ogg->size);
+}
+
+static void
+res_prepare_ogg(struct asset_job *job)
+{
+	struct res_entry *res = &resfiles[job->key];
+	stb_vorbis_info info;
+	stb_vorbis *vorbis;
+	size_t size = 0;
+	char *data;
+	int err;
+
+	data = io.file_map(res->file, &size);
+	if (!data)
+		return;
+	vorbis = stb_vorbis_open_memory((unsigned char *)data, size, &err, NULL);
+	if (!vorbis) {
+		warn("%s: vorbis error %d\n", res->file, err);
+		io.file_unmap(data, size);
+		return;
+	}
+	info = stb_vorbis_get_info(vorbis);
+	if (info.channels < 1 || info.channels > 2) {
+		warn("%s: %d channels not supported\n", res->file, info.channels);
+		stb_vorbis_close(vorbis);
+		io.file_unmap(data, size);
+		return;
+	}
+
+	job->ogg.vorbis = vorbis;
+	job->ogg.data = data;
+	job->ogg.size = size;
+	job->read = size;
+	job->time = io.file_time(res->file);
+	job->ok = 1;
+}
+
+static int
+res_finish_ogg(struct game_asset *game_asset, struct asset_job *job)
+{
+	struct res_data *old = &game_asset->assets[job->key];
+	stb_vorbis *vorbis = job->ogg.vorbis;
+	stb_vorbis_info info = stb_vorbis_get_info(vorbis);
+	struct ogg_stream *ogg;
+
+	/* reuse the previous stream in place, samplers keep pointing to it */
+	if (old->base && ((struct wav *)old->base)->stream) {
+		ogg = old->base;
+		ogg_close(ogg);
+	} else {
+		ogg = asset_push(game_asset, sizeof(struct ogg_stream));
+	}
+
+	ogg->vorbis = vorbis;
+	ogg->data = job->ogg.data;
+	ogg->size = job->ogg.size;
+	stream_init(&ogg->stream, info.channels, ogg_decode, ogg_seek, ogg);
+
+	memset(&ogg->wav, 0, sizeof(ogg->wav));
+	ogg->wav.header.channels = info.channels;
+	ogg->wav.header.samplerate = info.sample_rate;
+	ogg->wav.extras.samplesize = sizeof(int16_t);
+	ogg->wav.extras.nb_frames = stb_vorbis_stream_length_in_samples(vorbis);
+	ogg->wav.extras.nb_samples = ogg->wav.extras.nb_frames * info.channels;
+	ogg->wav.extras.frame_size = sizeof(int16_t) * info.channels;
+	ogg->wav.stream = &ogg->stream;
+
+	return 1;
+}
+
+/* start, pump or stop the decoding of every streamed sound */
+static void
+asset_streams(struct game_asset *game_asset, int stop)
+{
+	enum asset_key key;
+	struct ogg_stream *ogg;
+
+	for (key = 0; key < ASSET_KEY_COUNT; key++) {
+		if (resfiles[key].type != SOUND_OGG || game_asset->assets[key].state != STATE_LOADED)
+			continue;
+		ogg = game_asset->assets[key].base;
+		if (stop) {
+			stream_stop(&ogg->stream);
+			continue;
+		}
+		/* the stream outlives a game code reload, its callbacks
+		 * must point into the code loaded now before it restarts */
+		if (!ogg->stream.running) {
+			ogg->stream.decode = ogg_decode;
+			ogg->stream.seek_to = ogg_seek;
+			ogg->stream.ctx = ogg;
+		}
+		stream_update(&ogg->stream);
 	}
-	/* restore memory zone */
-	*game_asset->samples = mem_state;
 }
 
 #include "stb_image.h"
 
 static void
-res_reload_png(struct game_asset *game_asset, enum asset_key key)
+res_prepare_png(struct asset_job *job)
 {
-	struct memory_zone mem_state = game_asset->tmpzone;
-	struct texture *tex;
-	struct res_entry *res = &resfiles[key];
+	struct res_entry *res = &resfiles[job->key];
 	struct asset_file file;
-	int w = 1000, h = 1000, n;
+	unsigned char *data;
+
+	file = res_load_file(&job->zone, res->file);
+	if (!file.data)
+		return;
+	data = stbi_load_from_memory((stbi_uc*) file.data, file.size, &job->png.w, &job->png.h, &job->png.n, 0);
+	if (data == NULL || job->png.n == 0) {
+		stbi_image_free(data);
+		return;
+	}
 
-	file = res_load_file(&game_asset->tmpzone, res->file);
-	stbi_set_flip_vertically_on_load(1);
-	if (file.data) {
-		GLenum format;
-		unsigned char *data = stbi_load_from_memory((stbi_uc*) file.data, file.size, &w, &h, &n, 0);
-
-		if (data == NULL || n == 0)
-			goto out;
-
-		if (n == 1)
-			format = GL_RED;
-		else if (n == 2)
-			format = GL_RG;
-		else if (n == 3)
-			format = GL_RGB;
-		else if (n == 4)
-			format = GL_RGBA;
-		else
-			format = GL_RED;
+	job->png.pixels = data;
+	job->read = file.size;
+	job->time = file.time;
+	job->ok = 1;
+}
 
-		tex = asset_push(game_asset, key, sizeof(struct texture));
-		*tex = create_2d_tex(w, h, format, GL_UNSIGNED_BYTE, data);
+static int
+res_finish_png(struct game_asset *game_asset, struct asset_job *job)
+{
+	struct texture *tex;
+	GLenum format;
+	int n = job->png.n;
+
+	if (n == 1)
+		format = GL_RED;
+	else if (n == 2)
+		format = GL_RG;
+	else if (n == 3)
+		format = GL_RGB;
+	else if (n == 4)
+		format = GL_RGBA;
+	else
+		format = GL_RED;
+
+	tex = asset_push(game_asset, sizeof(struct texture));
+	*tex = create_2d_tex(job->png.w, job->png.h, format, GL_UNSIGNED_BYTE, job->png.pixels);
+	stbi_image_free(job->png.pixels);
+
+	return 1;
+}
 
-		asset_since(game_asset, key, file.time);
-		asset_state(game_asset, key, STATE_LOADED);
+/* worker side of a load */
+static void
+asset_prepare(void *arg)
+{
+	struct asset_job *job = arg;
+	double start = io.get_time();
+
+	switch (resfiles[job->key].type) {
+	case SHADER:
+		res_prepare_shader(job);
+		break;
+	case MESH_OBJ:
+		res_prepare_mesh_obj(job, resfiles[job->key].file);
+		break;
+	case MESH_BIN:
+		res_prepare_mesh_bin(job);
+		break;
+	case SOUND_WAV:
+		res_prepare_wav(job);
+		break;
+	case SOUND_OGG:
+		res_prepare_ogg(job);
+		break;
+	case TEXTURE_PNG:
+		res_prepare_png(job);
+		break;
+	default:
+		break;
+	}
+
+	job->decode = io.get_time() - start;
+	__atomic_store_n(&job->done, 1, __ATOMIC_RELEASE);
+}
+
+/* main thread side, return 1 if a mesh was loaded */
+/* Shaders are compiled by the driver while the current version keeps
+ * drawing and finish once linked. Without KHR_parallel_shader_compile
+ * the compile blocks, only one is started per poll. */
+static int
+asset_ready(struct asset_job *job, int *compiles)
+{
+	struct res_entry *res = &resfiles[job->key];
+	char name[256];
+	double start;
+
+	if (res->type != SHADER || !job->ok)
+		return 1;
+	if (!job->shader.submitted) {
+		if (!shader_parallel() && (*compiles)++)
+			return 0;
+		job->shader.submitted = 1;
+		start = io.get_time();
+		/* the sources name the cache file, a new version replaces it */
+		snprintf(name, sizeof(name), "%s %s %s", res->vert, res->frag, res->geom ? res->geom : "");
+		if (shader_submit(&job->shader.build, NULL, name, job->shader.vert.data,
+				  job->shader.frag.data, job->shader.geom.data))
+			job->ok = 0;
+		job->upload = io.get_time() - start;
+		if (!job->ok)
+			return 1;
+	}
+
+	return shader_ready(&job->shader.build);
+}
+
+static void
+res_mesh_stats(struct asset_stats *stats, struct asset_job *job, enum res_type type)
+{
+	stats->indices = stats->vertices = 0;
+	stats->acmr_file = stats->acmr = 0;
+	/* a baked mesh is reordered by meshc */
+	if ((type != MESH_OBJ && type != MESH_BIN) || job->mesh.file)
+		return;
+	stats->indices = job->mesh.obj.index_count;
+	stats->vertices = job->mesh.obj.vertex_count;
+	stats->acmr_file = job->mesh.acmr_file;
+	stats->acmr = job->mesh.acmr;
+}
+
+static int
+asset_finish(struct game_asset *game_asset, struct asset_job *job)
+{
+	struct res_data *res = &game_asset->assets[job->key];
+	enum res_type type = resfiles[job->key].type;
+	double start = io.get_time();
+	int ok = job->ok;
+
+	if (ok) {
+		switch (type) {
+		case SHADER:
+			ok = res_finish_shader(game_asset, job);
+			break;
+		case MESH_OBJ:
+		case MESH_BIN:
+			ok = res_finish_mesh(game_asset, job);
+			break;
+		case SOUND_WAV:
+			ok = res_finish_wav(game_asset, job);
+			break;
+		case SOUND_OGG:
+			ok = res_finish_ogg(game_asset, job);
+			break;
+		case TEXTURE_PNG:
+			ok = res_finish_png(game_asset, job);
+			break;
+		default:
+			ok = 0;
+			break;
+		}
 	}
-out:
-	/* restore memory zone */
-	game_asset->tmpzone = mem_state;
+
+	asset_commit(game_asset, job->key, ok);
+	if (ok) {
+		res->stats.read = job->read;
+		res->stats.decode = job->decode;
+		res->stats.upload = job->upload + io.get_time() - start;
+		res_mesh_stats(&res->stats, job, type);
+		asset_since(game_asset, job->key, job->time);
+		asset_state(game_asset, job->key, STATE_LOADED);
+	} else if (res->state == STATE_LOADING) {
+		/* not retried until its files change, a failed reload keeps
+		 * the previous version */
+		warn("asset %d: failed to load\n", job->key);
+		asset_state(game_asset, job->key, STATE_FAILED);
+	}
+
+	if (job->zone.base != job->scratch.base)
+		heap_free(&game_asset->heap, job->zone.base);
+	res->job = NULL;
+	job->busy = 0;
+
+	return ok && (type == MESH_OBJ || type == MESH_BIN);
+}
+
+/* scratch memory of a load, obj meshes grow with the file */
+static size_t
+asset_zone_size(enum asset_key key)
+{
+	struct res_entry *res = &resfiles[key];
+	const char *obj = NULL;
+	int64_t size;
+
+	if (res->type == MESH_OBJ)
+		obj = res->file;
+	/* the source of a baked mesh is parsed when it is newer */
+	else if (res->type == MESH_BIN && io.file_time(res->file) < io.file_time(res->src))
+		obj = res->src;
+	if (!obj || (size = io.file_size(obj)) <= 0)
+		return ASSET_JOB_ZONE;
+
+	return MAX(ASSET_OBJ_ZONE((size_t)size), ASSET_JOB_ZONE);
 }
 
+/* start the load of an asset, the current version if any is used until
+ * it is done. Return 0 if no job is free. */
 static int
-res_file_changed(struct res_entry *res, time_t since)
+asset_request(struct game_asset *game_asset, enum asset_key key)
+{
+	struct res_data *res = &game_asset->assets[key];
+	struct asset_job *job = NULL;
+	struct memory_zone scratch;
+	double start;
+	size_t i, need;
+
+	if (res->job)
+		return 0;
+
+	switch (resfiles[key].type) {
+	case SHADER:
+	case MESH_OBJ:
+	case MESH_BIN:
+	case SOUND_WAV:
+	case SOUND_OGG:
+	case TEXTURE_PNG:
+		break;
+	default:
+		/* generated or cheap, done right away */
+		start = io.get_time();
+		asset_reload(game_asset, key);
+		res->stats.upload = io.get_time() - start;
+		if (res->state != STATE_LOADED)
+			asset_state(game_asset, key, STATE_FAILED);
+		return 1;
+	}
+
+	for (i = 0; i < ASSET_JOBS && !job; i++)
+		if (!game_asset->jobs[i].busy)
+			job = &game_asset->jobs[i];
+	if (!job)
+		return 0;
+
+	/* an obj is parsed in memory sized from the file, too large ones
+	 * must be baked by meshc */
+	need = asset_zone_size(key);
+	if (need > ASSET_JOB_ZONE && need > heap_avail(&game_asset->heap)) {
+		warn("asset %d: %zu bytes needed to parse, bake it with meshc\n", key, need);
+		asset_state(game_asset, key, STATE_FAILED);
+		return 1;
+	}
+
+	scratch = job->scratch;
+	memset(job, 0, sizeof(*job));
+	job->scratch = scratch;
+	job->scratch.used = 0;
+	job->zone = job->scratch;
+	if (need > ASSET_JOB_ZONE)
+		job->zone = memory_zone_init(heap_alloc(&game_asset->heap, need), need);
+	job->game_asset = game_asset;
+	job->key = key;
+	job->busy = 1;
+
+	res->job = job;
+
+	job_pool_start(&game_asset->pool);
+	if (!job_push(&game_asset->pool, asset_prepare, job)) {
+		if (job->zone.base != job->scratch.base)
+			heap_free(&game_asset->heap, job->zone.base);
+		res->job = NULL;
+		job->busy = 0;
+		return 0;
+	}
+
+	return 1;
+}
+
+/* load or reload an asset, it is requested by the next poll */
+static void
+asset_want(struct game_asset *game_asset, enum asset_key key)
 {
-	time_t ctime, time = since;
+	struct res_data *res = &game_asset->assets[key];
+
+	res->pending = 1;
+	if (res->state == STATE_UNLOAD || res->state == STATE_FAILED)
+		asset_state(game_asset, key, STATE_LOADING);
+}
+
+/* files a resource is loaded from, NULL terminated */
+static size_t
+res_files(struct res_entry *res, const char *files[4])
+{
+	size_t n = 0;
+
+	/* keys without a resfiles entry are UNKNOWN with no file */
+	switch (res->type) {
+	case UNKNOWN:
+	case MESH_INTERNAL:
+		break;
+	case SHADER:
+		if (res->vert)
+			files[n++] = res->vert;
+		if (res->frag)
+			files[n++] = res->frag;
+		if (res->geom)
+			files[n++] = res->geom;
+		break;
+	case MESH_BIN:
+		if (res->src)
+			files[n++] = res->src;
+		/* fall through */
+	default:
+		if (res->file)
+			files[n++] = res->file;
+		break;
+	}
+	files[n] = NULL;
 
-	/* expect res->file to be the same as res->vert */
-	if (res->file != res->vert)
-		die("fixme: res_file_changed\n");
+	return n;
+}
 
-	ctime = io.file_time(res->vert);
-	time = MAX(ctime, time);
-	ctime = io.file_time(res->frag);
-	time = MAX(ctime, time);
-	ctime = io.file_time(res->geom);
-	time = MAX(ctime, time);
+static int
+res_uses_file(struct res_entry *res, const char *path)
+{
+	const char *files[4];
+	size_t i, n;
 
-	return since < time;
+	n = res_files(res, files);
+	for (i = 0; i < n; i++)
+		if (files[i] && strcmp(files[i], path) == 0)
+			return 1;
+
+	return 0;
 }
 
 static void *
@@ -485,8 +1124,13 @@ game_get_asset(struct game_asset *game_asset, enum asset_key key)
 	void *asset = NULL;
 
 	if (key < ASSET_KEY_COUNT) {
-		if (game_asset->assets[key].state != STATE_LOADED)
-			asset_reload(game_asset, key);
+		/* NULL until loaded, callers fall back on a placeholder */
+		if (game_asset->assets[key].state == STATE_UNLOAD) {
+			/* missing from the manifests */
+			warn("asset %d: loaded lazily\n", key);
+			game_asset->lazy_loads++;
+			asset_want(game_asset, key);
+		}
 		asset = game_asset->assets[key].base;
 	}
 
@@ -499,6 +1143,19 @@ game_get_shader(struct game_asset *game_asset, enum asset_key key)
 	return game_get_asset(game_asset, key);
 }
 
+/* return NULL for shaders without a depth only variant */
+struct shader *
+game_get_shader_depth(struct game_asset *game_asset, enum asset_key key)
+{
+	enum asset_key depth = resfiles[key].depth;
+
+	/* unset depth is 0, not a shader */
+	if (resfiles[key].type != SHADER || resfiles[depth].type != SHADER)
+		return NULL;
+
+	return game_get_shader(game_asset, depth);
+}
+
 struct mesh *
 game_get_mesh(struct game_asset *game_asset, enum asset_key key)
 {
@@ -553,24 +1210,144 @@ game_get_font_meta(struct game_asset *game_asset, enum asset_key key)
 	return meta;
 }
 
-void
+/* Finish the loads done by the workers within the frame budget and
+ * start the requested ones, changed assets are requested again. Return the number of meshes that
+ * were loaded. */
+int
 game_asset_poll(struct game_asset *game_asset)
 {
+	double start = io.get_time();
+	struct asset_job *job;
+	struct res_data *res;
+	enum asset_key key;
+	const char *path;
+	int meshes = 0;
+	int compiles = 0;
+	size_t i;
+
+	game_asset->frame++;
+	asset_collect(game_asset);
+
+	for (i = 0; i < ASSET_JOBS; i++) {
+		job = &game_asset->jobs[i];
+		if (!job->busy || !__atomic_load_n(&job->done, __ATOMIC_ACQUIRE))
+			continue;
+		if (!asset_ready(job, &compiles))
+			continue;
+		meshes += asset_finish(game_asset, job);
+		if (io.get_time() - start > ASSET_FINISH_BUDGET)
+			break;
+	}
+
+	/* several files of an asset may change at once, reload it once */
+	while ((path = io.file_changed())) {
+		for (key = 0; key < ASSET_KEY_COUNT; key++)
+			if (game_asset->assets[key].state != STATE_UNLOAD &&
+			    res_uses_file(&resfiles[key], path))
+				asset_want(game_asset, key);
+	}
+	for (key = 0; key < ASSET_KEY_COUNT; key++) {
+		res = &game_asset->assets[key];
+		if (res->pending && !res->job && asset_request(game_asset, key))
+			res->pending = 0;
+	}
+	asset_streams(game_asset, 0);
+
+	return meshes;
+}
+
+/* before the game code is unloaded: no thread must run in it */
+void
+game_asset_suspend(struct game_asset *game_asset)
+{
+	/* queued loads are run, they are finished by the next poll */
+	job_pool_stop(&game_asset->pool);
+	asset_streams(game_asset, 1);
+}
+
+/* request the assets of a manifest not loaded yet */
+void
+game_asset_preload(struct game_asset *game_asset, enum asset_manifest manifest)
+{
+	enum asset_key key;
+	size_t i;
+
+	for (i = 0; i < manifests[manifest].count; i++) {
+		key = manifests[manifest].keys[i];
+		if (game_asset->assets[key].state == STATE_UNLOAD)
+			asset_want(game_asset, key);
+	}
+}
+
+/* return 1 once every asset of a manifest is loaded or failed */
+int
+game_asset_ready(struct game_asset *game_asset, enum asset_manifest manifest)
+{
+	enum asset_state state;
+	size_t i;
+
+	for (i = 0; i < manifests[manifest].count; i++) {
+		state = game_asset->assets[manifests[manifest].keys[i]].state;
+		if (state != STATE_LOADED && state != STATE_FAILED)
+			return 0;
+	}
+
+	return 1;
+}
+
+/* print the load record and the memory held by each asset, GL objects
+ * are not accounted */
+void
+game_asset_report(struct game_asset *game_asset)
+{
+	const char *files[4];
+	struct res_data *res;
 	enum asset_key key;
-	time_t since;
+	size_t i, total = 0, read = 0;
+	double decode = 0, upload = 0;
 
+	printf("%-3s %-32s %10s %9s %9s %10s\n", "key", "file", "read", "decode", "upload", "resident");
 	for (key = 0; key < ASSET_KEY_COUNT; key++) {
-		since = game_asset->assets[key].since;
-		if (game_asset->assets[key].state == STATE_LOADED)
-			if (res_file_changed(&resfiles[key], since))
-				asset_reload(game_asset, key);
+		res = &game_asset->assets[key];
+		if (res->state != STATE_LOADED)
+			continue;
+		files[0] = NULL;
+		res_files(&resfiles[key], files);
+		printf("%-3d %-32s %10zu %7.2fms %7.2fms %10zu\n", key, files[0] ? files[0] : "-",
+		       res->stats.read, res->stats.decode * 1000, res->stats.upload * 1000, res->resident);
+		read += res->stats.read;
+		decode += res->stats.decode;
+		upload += res->stats.upload;
+		total += res->resident;
 	}
+	printf("%-3s %-32s %10zu %7.2fms %7.2fms %10zu\n", "", "total", read, decode * 1000, upload * 1000, total);
+
+	printf("%-3s %-32s %10s %10s %13s\n", "key", "mesh", "indices", "vertices", "acmr");
+	for (key = 0; key < ASSET_KEY_COUNT; key++) {
+		res = &game_asset->assets[key];
+		if (res->state != STATE_LOADED || !res->stats.indices)
+			continue;
+		files[0] = NULL;
+		res_files(&resfiles[key], files);
+		printf("%-3d %-32s %10zu %10zu %6.3f %6.3f\n", key, files[0] ? files[0] : "-",
+		       res->stats.indices, res->stats.vertices, res->stats.acmr_file, res->stats.acmr);
+	}
+
+	for (i = 0; i < game_asset->retired_count; i++)
+		total += game_asset->retired[i].version.resident;
+	printf("assets: %zu bytes with %zu retired versions, heaps %zu + %zu bytes\n",
+	       total, game_asset->retired_count, game_asset->heap.used, game_asset->sample_heap.used);
+	printf("assets: %lu lazy loads\n", game_asset->lazy_loads);
 }
 
 void
 game_asset_init(struct game_asset *game_asset, struct memory_zone *memzone, struct memory_zone *samples)
 {
 	struct memory_zone tmpzone;
+	const char *files[4];
+	enum asset_key key;
+	size_t i, n;
+
 	tmpzone.base = mempush(memzone, SZ_4M);
 	tmpzone.size = SZ_4M;
 	tmpzone.used = 0;
@@ -578,6 +1355,27 @@ game_asset_init(struct game_asset *game_asset, struct memory_zone *memzone, stru
 	game_asset->memzone = memzone;
 	game_asset->samples = samples;
 	game_asset->tmpzone = tmpzone;
+	game_asset->heap = memory_heap_init(memzone);
+	game_asset->sample_heap = memory_heap_init(samples);
+	memset(&game_asset->building, 0, sizeof(game_asset->building));
+	game_asset->retired_count = 0;
+	game_asset->frame = 0;
+	game_asset->lazy_loads = 0;
+
+	game_asset->jobs = mempush(memzone, ASSET_JOBS * sizeof(struct asset_job));
+	for (i = 0; i < ASSET_JOBS; i++) {
+		memset(&game_asset->jobs[i], 0, sizeof(struct asset_job));
+		game_asset->jobs[i].scratch = memory_zone_init(mempush(memzone, ASSET_JOB_ZONE), ASSET_JOB_ZONE);
+	}
+	memset(&game_asset->pool, 0, sizeof(game_asset->pool));
+	stbi_set_flip_vertically_on_load(1);
+
+	for (key = 0; key < ASSET_KEY_COUNT; key++) {
+		n = res_files(&resfiles[key], files);
+		for (i = 0; i < n; i++)
+			if (files[i])
+				io.file_watch(files[i]);
+	}
 }
 
 void
@@ -585,6 +1383,8 @@ game_asset_fini(struct game_asset *game_asset)
 {
 	enum asset_key key;
 
+	job_pool_stop(&game_asset->pool);
+	asset_streams(game_asset, 1);
 	game_asset->samples->used = 0;
 	/* mark all asset as unloaded for now */
 	for (key = 0; key < ASSET_KEY_COUNT; key++) {
@@ -601,6 +1401,7 @@ init_wav(struct wav *wav, char *obj)
 	void *seek = obj;
 	size_t i;
 
+	wav->stream = NULL;
 	for (i = 0; i < 4; i++) {
 		header->riff_str[i] = *((char*) seek);
 		seek += 1;
@@ -655,222 +1456,3 @@ init_wav(struct wav *wav, char *obj)
 	wav->extras.frame_size = wav->extras.samplesize * header->channels;
 	wav->extras.nb_frames  = wav->extras.nb_samples / header->channels;
 }
-
-/* ----------------- obj loader ------------------ */
-
-struct vertex_index {
-	unsigned int p;
-	unsigned int t;
-	unsigned int n;
-};
-
-/* We consider only triangulated faces */
-struct face {
-	struct vertex_index v0;
-	struct vertex_index v1;
-	struct vertex_index v2;
-};
-
-static struct obj_info
-read_obj_info(struct asset_file *file)
-{
-	struct obj_info info;
-	size_t size = file->size;
-	char *obj = file->data;
-	char *line;
-	size_t i, len = 0;
-	size_t vcount = 0;
-	size_t tcount = 0;
-	size_t ncount = 0;
-	size_t fcount = 0;
-
-	/* count the number of vertices, normals, texcoord and faces */
-	for (i = 0; i < size; i += len) {
-		line = &obj[i];
-		for (len = 0; i + len < size; len++)
-			if (line[len] == '\n' || line[len] == '\0')
-				break;
-		if ((i + len) < size)
-			line[len++] = '\0'; /* replace '\n' with '\0' */
-
-		if (strncmp("v ", line, strlen("v ")) == 0) {
-			vcount++;
-		} else if (strncmp("vt ", line, strlen("vt ")) == 0) {
-			tcount++;
-		} else if (strncmp("vn ", line, strlen("vn ")) == 0) {
-			ncount++;
-		} else if (strncmp("f ", line, strlen("f ")) == 0) {
-			fcount++;
-		} else {
-			/* ingore the line */
-		}
-	}
-	info.vert_count = vcount;
-	info.texc_count = tcount;
-	info.norm_count = ncount;
-	info.face_count = fcount;
-
-	return info;
-}
-
-static void
-load_obj(struct memory_zone *zone, struct asset_file *file, struct obj_info info,
-	 size_t count, float *out_vert, float *out_norm, float *out_texc)
-{
-	struct memory_zone memory_state = *zone;
-	size_t size = file->size;
-	char *obj = file->data;
-	char *line;
-	int verbose = 0;
-	size_t i, len = 0;
-	size_t vcount = 0;
-	size_t tcount = 0;
-	size_t ncount = 0;
-	size_t fcount = 0;
-	vec3 *obj_vert;
-	vec3 *obj_texc;
-	vec3 *obj_norm;
-	struct face *obj_face;
-	float x, y, z;
-	int p0, p1, p2, t0, t1, t2, n0, n1, n2;
-	int n;
-
-	/* allocate temporary buffer for parsing the obj file */
-	obj_vert = mempush(zone, info.vert_count * sizeof(*obj_vert));
-	obj_texc = mempush(zone, info.texc_count * sizeof(*obj_texc));
-	obj_norm = mempush(zone, info.norm_count * sizeof(*obj_norm));
-	obj_face = mempush(zone, info.face_count * sizeof(*obj_face));
-
-	for (i = 0; i < size; i += len) {
-		line = &obj[i];
-		for (len = 0; (i + len) < size; len++)
-			if (line[len] == '\n' || line[len] == '\0')
-				break;
-		if ((i + len) < size)
-			line[len++] = '\0'; /* replace '\n' with '\0' */
-
-		// TODO: line ending with / are continuated;
-		if (strncmp("v ", line, strlen("v ")) == 0) {
-			n = sscanf(line, "v %f %f %f", &x, &y, &z);
-			if (n == 3) {
-				if (verbose)
-					printf("v %f %f %f\n", x, y, z);
-				obj_vert[vcount++] = (vec3) {x, y, z};
-			} else {
-				fprintf(stderr, "Malformed line starting with 'v '\n");
-			}
-		} else if (strncmp("vt ", line, strlen("vt ")) == 0) {
-			/*
-			  We assume all textures are 2D textures:
-			  We look for lines of the form
-			  "vt u v \n"
-			  with:
-			  - u the value for the horizontal direction
-			  - v the value for the vertical direction
-			  TODO: accept 1D, 2D, 3D textures
-			  i.e lines of form:
-			  "vt u \n"
-			  "vt u v \n"
-			  "vt u v w \n"
-			 */
-			n = sscanf(line, "vt %f %f", &x, &y);
-			if (n == 2) {
-				if (verbose)
-					printf("vt %f %f \n", x, y);
-				obj_texc[tcount++] = (vec3) {x, y, 0};
-			} else {
-				fprintf(stderr, "Malformed line starting with 'vt '\n");
-			}
-		} else if (strncmp("vn ", line, strlen("vn ")) == 0) {
-			n = sscanf(line, "vn %f %f %f", &x, &y, &z);
-			if (n == 3) {
-				if (verbose)
-					printf("vn %f %f %f \n", x, y, z);
-				obj_norm[ncount++] = (vec3) {x, y, z};
-			} else {
-				fprintf(stderr, "Malformed line starting with 'vn '\n");
-			}
-		} else if (strncmp("f ", line, strlen("f ")) == 0) {
-			/* A face line starts with 'f' and is followed by triplets
-			   of the form "vertex/texcoord/normal".
-			   Example, for a mesh with triangular faces:
-			   "f a1/b1/c1 a2/b2/c2 a3/b3/c3 \n"
-			   With:
-			   - a is the index of a vertex in the obj file vertex list
-			   - b is the index of a texture coordinate in the obj texcoords list
-			   - c is the index of a normal in the obj file normal list
-			   Rem:
-			   - in obj files, indices starts from 1
-			   arrays indices start from 0 hence the Vertices[a-1] bellow.
-			   - For now we only accept mesh with triangular faces.
-			   Todo: accept more cellular division by adapting
-			   format string fmt bellow.
-			   - We assume texture coordinates and normal are present
-			   Todo: accept faces lines of the form
-			   - "f a1 a2 a3 \n"
-			   - "f a1/b1 a2/b2 a3/b3 \n"
-			   - "f a1/c1 a2/c2 a3/c3 \n"
-			*/
-			n = sscanf(line, "f %d/%d/%d %d/%d/%d %d/%d/%d",
-				   &p0,&t0,&n0, &p1,&t1,&n1, &p2,&t2,&n2);
-			if (n != 9) {
-				/* without textcoord */
-				t0 = t1 = t2 = 0;
-				n = sscanf(line, "f %d//%d %d//%d %d//%d",
-					   &p0,&n0, &p1,&n1, &p2,&n2);
-			}
-			if (n == 9 || n == 6) {
-				struct face f = {{p0, t0, n0}, {p1, t1, n1},  {p2, t2, n2}};
-				if (verbose)
-					printf("f %d/%d/%d %d/%d/%d %d/%d/%d \n",
-					       p0,t0,n0, p1,t1,n1, p2,t2,n2);
-				obj_face[fcount++] = f;
-			} else {
-				fprintf(stderr, "Malformed line starting with 'f '\n");
-			}
-		} else {
-			/* ingore the line */
-		}
-	}
-
-	fcount = MIN(fcount, count);
-	if (out_vert) {
-		for (i = 0; i < fcount; i++) {
-			out_vert[i*9 + 0] = obj_vert[obj_face[i].v0.p - 1].x;
-			out_vert[i*9 + 1] = obj_vert[obj_face[i].v0.p - 1].y;
-			out_vert[i*9 + 2] = obj_vert[obj_face[i].v0.p - 1].z;
-			out_vert[i*9 + 3] = obj_vert[obj_face[i].v1.p - 1].x;
-			out_vert[i*9 + 4] = obj_vert[obj_face[i].v1.p - 1].y;
-			out_vert[i*9 + 5] = obj_vert[obj_face[i].v1.p - 1].z;
-			out_vert[i*9 + 6] = obj_vert[obj_face[i].v2.p - 1].x;
-			out_vert[i*9 + 7] = obj_vert[obj_face[i].v2.p - 1].y;
-			out_vert[i*9 + 8] = obj_vert[obj_face[i].v2.p - 1].z;
-		}
-	}
-	if (out_norm && ncount > 0) {
-		for (i = 0; i < fcount; i++) {
-			out_norm[i*9 + 0] = obj_norm[obj_face[i].v0.n - 1].x;
-			out_norm[i*9 + 1] = obj_norm[obj_face[i].v0.n - 1].y;
-			out_norm[i*9 + 2] = obj_norm[obj_face[i].v0.n - 1].z;
-			out_norm[i*9 + 3] = obj_norm[obj_face[i].v1.n - 1].x;
-			out_norm[i*9 + 4] = obj_norm[obj_face[i].v1.n - 1].y;
-			out_norm[i*9 + 5] = obj_norm[obj_face[i].v1.n - 1].z;
-			out_norm[i*9 + 6] = obj_norm[obj_face[i].v2.n - 1].x;
-			out_norm[i*9 + 7] = obj_norm[obj_face[i].v2.n - 1].y;
-			out_norm[i*9 + 8] = obj_norm[obj_face[i].v2.n - 1].z;
-		}
-	}
-	if (out_texc && tcount > 0) {
-		for (i = 0; i < fcount; i++) {
-			out_texc[i*6 + 0] = obj_texc[obj_face[i].v0.t - 1].x;
-			out_texc[i*6 + 1] = obj_texc[obj_face[i].v0.t - 1].y;
-			out_texc[i*6 + 2] = obj_texc[obj_face[i].v1.t - 1].x;
-			out_texc[i*6 + 3] = obj_texc[obj_face[i].v1.t - 1].y;
-			out_texc[i*6 + 4] = obj_texc[obj_face[i].v2.t - 1].x;
-			out_texc[i*6 + 5] = obj_texc[obj_face[i].v2.t - 1].y;
-		}
-	}
-
-	/* restore memory state */
-	*zone = memory_state;
-}
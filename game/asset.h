@@ -1,6 +1,15 @@
 #pragma once
 #include <time.h>
 #include "core/util.h"
+#include "core/job.h"
+
+#define ASSET_JOBS 4 /* loads in flight */
+#define ASSET_JOB_ZONE SZ_4M /* scratch memory of a load */
+/* scratch to parse an obj, measured with tools/bench-obj */
+#define ASSET_OBJ_ZONE(size) ((size) * 4 + SZ_1M)
+#define ASSET_FINISH_BUDGET 0.004 /* seconds per frame finishing loads */
+#define ASSET_RETIRED 16 /* old versions waiting to be released */
+#define ASSET_RETIRE_FRAMES 2 /* frames before an old version is released */
 
 enum asset_key {
 	DEBUG_MESH_CROSS,
@@ -17,6 +26,7 @@ enum asset_key {
 	SHADER_TEST,
 	SHADER_SKY,
 	SHADER_GUI,
+	SHADER_DEPTH,
 	TEXTURE_GUI_SHAPE,
 	TEXTURE_TEXT,
 
@@ -25,31 +35,74 @@ enum asset_key {
 	ASSET_KEY_COUNT,
 	/* internal assets id starts here, they are not handled as regular
 	 * assets and should not be passed to game_get_*() */
-	INTERNAL_TEXTURE,
+	INTERNAL_TEXTURE_SHADOWMAP,
+	INTERNAL_TEXTURE_SHADOWMAP_NEAR,
+};
+
+/* assets preloaded for a part of the game */
+enum asset_manifest {
+	MANIFEST_MENU,
+	MANIFEST_PLAY,
+	MANIFEST_DEBUG,
+	MANIFEST_COUNT,
 };
 
 enum asset_state {
 	STATE_UNLOAD,
+	STATE_LOADING, /* first load requested, base is NULL */
 	STATE_LOADED,
+	STATE_FAILED, /* retried when its files change */
+};
+
+struct res_data {
+	enum asset_state state;
+	time_t since;
+	size_t size;
+	void *base;
+	struct asset_block *blocks; /* memory of this version */
+	size_t resident; /* bytes in blocks */
+	struct asset_stats {
+		size_t read; /* bytes read or mapped */
+		double decode; /* seconds on a worker */
+		double upload; /* seconds on the main thread */
+		/* index reordering of an obj mesh, 0 for others */
+		size_t indices, vertices;
+		float acmr_file, acmr;
+	} stats; /* of the last load */
+	struct asset_job *job; /* load in flight, NULL if none */
+	int pending; /* (re)load requested, started once a job is free */
 };
 
 struct game_asset {
 	struct memory_zone *memzone;
 	struct memory_zone  tmpzone;
 	struct memory_zone *samples;
-	struct res_data {
-		enum asset_state state;
-		time_t since;
-		size_t size;
-		void *base;
-	} assets[ASSET_KEY_COUNT];
+	struct memory_heap heap; /* asset versions, in memzone */
+	struct memory_heap sample_heap; /* sound data, in samples */
+	struct job_pool pool;
+	struct asset_job *jobs; /* ASSET_JOBS loads */
+	struct res_data building; /* version being loaded, see asset_commit() */
+	unsigned long frame;
+	unsigned long lazy_loads; /* assets first used before being preloaded */
+	size_t retired_count;
+	struct asset_retired {
+		enum asset_key key;
+		unsigned long frame; /* when it was replaced */
+		struct res_data version;
+	} retired[ASSET_RETIRED];
+	struct res_data assets[ASSET_KEY_COUNT];
 };
 
 void game_asset_init(struct game_asset *game_asset, struct memory_zone *memzone, struct memory_zone *samples);
 void game_asset_fini(struct game_asset *game_asset);
-void game_asset_poll(struct game_asset *game_asset);
+int game_asset_poll(struct game_asset *game_asset);
+void game_asset_suspend(struct game_asset *game_asset);
+void game_asset_report(struct game_asset *game_asset);
+void game_asset_preload(struct game_asset *game_asset, enum asset_manifest manifest);
+int game_asset_ready(struct game_asset *game_asset, enum asset_manifest manifest);
 
 struct shader *game_get_shader(struct game_asset *game_asset, enum asset_key key);
+struct shader *game_get_shader_depth(struct game_asset *game_asset, enum asset_key key);
 struct mesh *game_get_mesh(struct game_asset *game_asset, enum asset_key key);
 struct wav *game_get_wav(struct game_asset *game_asset, enum asset_key key);
 struct smf * game_get_smf(struct game_asset *game_asset, enum asset_key key);
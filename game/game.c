@@ -67,6 +67,52 @@ void rand_jump(void) {
 	s[3] = s3;
 }
 
+static int
+map_cell_coord(float x)
+{
+	int c = (x + MAP_SIZE / 2) * (MAP_GRID / MAP_SIZE);
+
+	return MIN(MAX(c, 0), MAP_GRID - 1);
+}
+
+static int
+map_cell_index(vec3 pos)
+{
+	return map_cell_coord(pos.z) * MAP_GRID + map_cell_coord(pos.x);
+}
+
+static int
+ent_cell_cmp(const void *a, const void *b)
+{
+	return map_cell_index(((struct ent *)a)->pos) - map_cell_index(((struct ent *)b)->pos);
+}
+
+static void
+map_build_grid(struct map *map)
+{
+	struct map_cell *cell;
+	size_t i;
+
+	qsort(map->rocks, ARRAY_LEN(map->rocks), sizeof(struct ent), ent_cell_cmp);
+	qsort(map->small, ARRAY_LEN(map->small), sizeof(struct ent), ent_cell_cmp);
+	memset(map->cells, 0, sizeof(map->cells));
+
+	for (i = 0; i < ARRAY_LEN(map->rocks); i++) {
+		struct ent *e = &map->rocks[i];
+		cell = &map->cells[map_cell_coord(e->pos.z)][map_cell_coord(e->pos.x)];
+		if (cell->rock_count++ == 0)
+			cell->rocks = i;
+		cell->scale = MAX(cell->scale, e->scale);
+	}
+	for (i = 0; i < ARRAY_LEN(map->small); i++) {
+		struct ent *e = &map->small[i];
+		cell = &map->cells[map_cell_coord(e->pos.z)][map_cell_coord(e->pos.x)];
+		if (cell->small_count++ == 0)
+			cell->small = i;
+		cell->scale = MAX(cell->scale, e->scale);
+	}
+}
+
 static void
 game_gen_map(struct map *map)
 {
@@ -102,13 +148,14 @@ game_gen_map(struct map *map)
 		};
 		map->small[i] = r;
 	}
+	map_build_grid(map);
 }
 
 void
-sys_init(struct system *sys, struct memory_zone zone)
+sys_init(struct system *sys, struct memory_zone zone, size_t size)
 {
 	sys->zone = zone;
-	list_init(&sys->list);
+	cmdbuf_init(&sys->cmds, &sys->zone, size, 256);
 }
 
 void
@@ -118,6 +165,12 @@ game_init(struct game_memory *game_memory)
 	g_asset = mempush(&game_memory->asset, sizeof(struct game_asset));
 
 	game_asset_init(g_asset, &game_memory->asset, &game_memory->audio);
+	/* warm up: everything is loaded while in GAME_INIT */
+	g_state->telemetry = game_memory->telemetry;
+	g_state->warmup = io.get_time();
+	game_asset_preload(g_asset, MANIFEST_MENU);
+	game_asset_preload(g_asset, MANIFEST_PLAY);
+	game_asset_preload(g_asset, MANIFEST_DEBUG);
 
 	camera_init(&g_state->cam, 1.05, 1);
 	camera_set_znear(&g_state->cam, 0.1);
@@ -144,6 +197,14 @@ game_fini(struct game_memory *memory)
 	game_asset_fini(game_asset);
 }
 
+/* called before the library is reloaded, state is kept */
+void
+game_unload(struct game_memory *memory)
+{
+	struct game_asset *game_asset = memory->asset.base;
+	game_asset_suspend(game_asset);
+}
+
 static void
 dbg_origin_mark(void)
 {
@@ -233,8 +294,8 @@ static void
 dbg_circle(vec3 at, vec3 scale, vec3 color)
 {
 	if (g_state->debug)
-	sys_render_push(&(struct render_entry){
-			.shader = SHADER_SOLID,
+	sys_render_push(&(struct render_cmd){
+			.material = MATERIAL_SOLID,
 			.mesh = DEBUG_MESH_SPHERE,
 			.scale = scale,
 			.position = at,
@@ -257,8 +318,8 @@ dbg_line(vec3 a, vec3 b, vec3 color)
 	vec3 pos = vec3_add(a, vec3_mult(0.5, dir));
 	vec3 scale = {0, 0, vec3_norm(dir) * 0.5};
 	quaternion rot = quaternion_look_at(dir, (vec3){0,1,0});
-	sys_render_push(&(struct render_entry){
-			.shader = SHADER_SOLID,
+	sys_render_push(&(struct render_cmd){
+			.material = MATERIAL_SOLID,
 			.mesh = DEBUG_MESH_CROSS,
 			.scale = scale,
 			.position = pos,
@@ -449,50 +510,103 @@ game_play(void)
 static void
 game_render(void)
 {
-	struct texture *depth = &g_state->depth;
-	sys_render_push(&(struct render_entry){
-			.shader = SHADER_TEST,
+	sys_render_push(&(struct render_cmd){
+			.material = MATERIAL_WORLD,
 			.mesh = MESH_FLOOR,
+			.flags = RENDER_NO_SHADOW,
 			.scale = {1.0, 1.0, 1.0},
-			.cull = 0,
 			.position = g_state->player_pos,
 			.rotation = QUATERNION_IDENTITY,
-			.texture = {
-				{.name = "shadowmap", .res_id = INTERNAL_TEXTURE, .tex = depth }
-			},
 		});
 
 	struct map *map = &g_state->map;
-	for (size_t i = 0; i < ARRAY_LEN(map->rocks); i++) {
-		vec3 scale = { map->rocks[i].scale, map->rocks[i].scale, map->rocks[i].scale};
-		sys_render_push(&(struct render_entry){
-				.shader = SHADER_TEST,
-				.mesh = MESH_ROCK_PILAR,
-				.scale = scale,
-				.cull = 1,
-				.position = map->rocks[i].pos,
-				.rotation = map->rocks[i].rot,
-				.texture = {
-					{.name = "shadowmap", .res_id = INTERNAL_TEXTURE, .tex = depth }
-				},
-			});
-	}
-	for (size_t i = 0; i < ARRAY_LEN(map->small); i++) {
-		vec3 scale = { map->small[i].scale, map->small[i].scale, map->small[i].scale};
-		sys_render_push(&(struct render_entry){
-				.shader = SHADER_TEST,
-				.mesh = MESH_ROCK_SMALL,
-				.scale = scale,
-				.cull = 1,
-				.position = map->small[i].pos,
-				.rotation = map->small[i].rot,
-				.texture = {
-					{.name = "shadowmap", .res_id = INTERNAL_TEXTURE, .tex = depth }
-				},
-			});
-	}
-	sys_render_push(&(struct render_entry){
-			.shader = SHADER_SKY,
+	struct camera *cam = &g_state->cam;
+	float w = MAP_SIZE / MAP_GRID;
+	float reach = 0;
+	float cx[MAP_GRID * MAP_GRID], cy[MAP_GRID * MAP_GRID];
+	float cz[MAP_GRID * MAP_GRID], cr[MAP_GRID * MAP_GRID];
+	uint32_t cam_visible[MAP_GRID * MAP_GRID / 32], sun_visible[MAP_GRID * MAP_GRID / 32];
+	uint32_t cascade_visible[MAP_GRID * MAP_GRID / 32];
+	vec4 cam_frustum[6], sun_frustum[6];
+	mat4 vm;
+	int x, z;
+	size_t j;
+
+	vm = mat4_mult_mat4(&cam->proj, &cam->view);
+	mat4_projection_frustum(&vm, cam_frustum);
+
+	/* how far an ent of scale 1 can extend from its position */
+	struct mesh *mesh = game_get_mesh(g_asset, MESH_ROCK_PILAR);
+	reach = MAX(reach, vec3_norm(mesh->bounding.off) + mesh->bounding.radius);
+	mesh = game_get_mesh(g_asset, MESH_ROCK_SMALL);
+	reach = MAX(reach, vec3_norm(mesh->bounding.off) + mesh->bounding.radius);
+
+	for (z = 0; z < MAP_GRID; z++) {
+	for (x = 0; x < MAP_GRID; x++) {
+		int c = z * MAP_GRID + x;
+		cx[c] = -MAP_SIZE / 2 + (x + 0.5) * w;
+		cy[c] = 0;
+		cz[c] = -MAP_SIZE / 2 + (z + 0.5) * w;
+		cr[c] = w * M_SQRT1_2 + 0.1 + map->cells[z][x].scale * reach;
+	}
+	}
+	spheres_in_frustum(cam_frustum, cx, cy, cz, cr, ARRAY_LEN(cx), cam_visible);
+
+	/* static casters are only needed by the cascades to update */
+	memset(sun_visible, 0, sizeof(sun_visible));
+	for (j = 0; j < SHADOW_CASCADES; j++) {
+		if (!g_state->cascades[j].dirty)
+			continue;
+		mat4_projection_frustum(&g_state->shadow_mat[j], sun_frustum);
+		spheres_in_frustum(sun_frustum, cx, cy, cz, cr, ARRAY_LEN(cx), cascade_visible);
+		for (x = 0; x < (int)ARRAY_LEN(sun_visible); x++)
+			sun_visible[x] |= cascade_visible[x];
+	}
+
+	/* reject whole cells, keep the ones seen by the camera before the
+	 * fog hides them, or that can cast a shadow */
+	for (z = 0; z < MAP_GRID; z++) {
+	for (x = 0; x < MAP_GRID; x++) {
+		struct map_cell *cell = &map->cells[z][x];
+		int c = z * MAP_GRID + x;
+		vec3 center = { cx[c], cy[c], cz[c] };
+		int in_cam = cam_visible[c / 32] & (1u << (c % 32));
+		int in_sun = sun_visible[c / 32] & (1u << (c % 32));
+		size_t i;
+
+		if (cell->rock_count == 0 && cell->small_count == 0)
+			continue;
+		if (in_cam && vec3_dist(center, cam->position) - cr[c] > MAP_FOG_DIST)
+			in_cam = 0;
+		if (!in_cam && !in_sun)
+			continue;
+
+		for (i = cell->rocks; i < cell->rocks + cell->rock_count; i++) {
+			vec3 scale = { map->rocks[i].scale, map->rocks[i].scale, map->rocks[i].scale};
+			sys_render_push(&(struct render_cmd){
+					.material = MATERIAL_WORLD,
+					.mesh = MESH_ROCK_PILAR,
+					.flags = RENDER_CULL | RENDER_STATIC,
+					.scale = scale,
+					.position = map->rocks[i].pos,
+					.rotation = map->rocks[i].rot,
+				});
+		}
+		for (i = cell->small; i < cell->small + cell->small_count; i++) {
+			vec3 scale = { map->small[i].scale, map->small[i].scale, map->small[i].scale};
+			sys_render_push(&(struct render_cmd){
+					.material = MATERIAL_WORLD,
+					.mesh = MESH_ROCK_SMALL,
+					.flags = RENDER_CULL | RENDER_STATIC,
+					.scale = scale,
+					.position = map->small[i].pos,
+					.rotation = map->small[i].rot,
+				});
+		}
+	}
+	}
+	sys_render_push(&(struct render_cmd){
+			.material = MATERIAL_SKY,
 			.mesh = MESH_QUAD,
 			.scale = {1, 1, 1},
 			.position = {0, 0, 0},
@@ -702,7 +816,15 @@ static void
 game_main(void)
 {
 	switch (g_state->state) {
-	case GAME_INIT: /* nothing to do */
+	case GAME_INIT: /* wait for the warm up */
+		if (!game_asset_ready(g_asset, MANIFEST_MENU) ||
+		    !game_asset_ready(g_asset, MANIFEST_PLAY) ||
+		    !game_asset_ready(g_asset, MANIFEST_DEBUG))
+			break;
+		if (g_state->telemetry) {
+			game_asset_report(g_asset);
+			printf("warm up: %.2fms\n", (io.get_time() - g_state->warmup) * 1000);
+		}
 		g_state->next_state = GAME_MENU;
 		g_state->mouse_grabbed = 1;
 		io.show_cursor(!g_state->mouse_grabbed);
@@ -720,17 +842,18 @@ game_main(void)
 			g_state->next_state = GAME_MENU;
 		break;
 	}
-	game_render();
 	if (g_state->state == g_state->next_state)
 		return;
 
 	g_state->state = g_state->next_state;
 	switch (g_state->state) {
 	case GAME_MENU:
+		game_asset_preload(g_asset, MANIFEST_MENU);
 		g_state->mouse_grabbed = 0;
 		io.show_cursor(!g_state->mouse_grabbed);
 		break;
 	case GAME_PLAY:
+		game_asset_preload(g_asset, MANIFEST_PLAY);
 		g_state->mouse_grabbed = 1;
 		io.show_cursor(!g_state->mouse_grabbed);
 		break;
@@ -796,16 +919,17 @@ listener_lerp(struct listener a, struct listener b, float x)
 void
 do_audio(struct audio *a)
 {
-	size_t i, j;
-	struct frame f;
+	size_t i, j, n;
+	struct frame f[SOUND_BLOCK];
 	static float lvol;
-	float x;
-	float vol, nvol = g_state->options.audio_mute ? 0.0 :
+	float x0, x1;
+	float nvol = g_state->options.audio_mute ? 0.0 :
 		g_state->options.main_volume;
 	struct sound *s;
 	struct listener cur;
 	struct listener nxt;
-	struct listener lis;
+	struct listener lis0;
+	struct listener lis1;
 
 	for (i = 0; i < a->size; i++) {
 		a->buffer[i].l = 0;
@@ -815,21 +939,26 @@ do_audio(struct audio *a)
 	cur = g_state->cur_listener;
 	nxt = g_state->nxt_listener;
 
+	/* the listener is interpolated per block */
 	for (i=0; i < NB_SOUND; i++) {
 		s = &g_state->sound[i];
-		for (j = 0; j < a->size; j++) {
-			x = j / (float)a->size;
-			lis = listener_lerp(cur, nxt, x);
-			if (sound_is_positional(s))
-				f = sound_pos_step(s, &lis);
-			else
-				f = sound_step(s);
-
-			vol = mix(lvol, nvol, x);
-			a->buffer[j].l += f.l * vol;
-			a->buffer[j].r += f.r * vol;
+		for (j = 0; j < a->size; j += n) {
+			n = MIN(a->size - j, SOUND_BLOCK);
+			x0 = j / (float)a->size;
+			x1 = (j + n) / (float)a->size;
+			if (sound_is_positional(s)) {
+				lis0 = listener_lerp(cur, nxt, x0);
+				lis1 = listener_lerp(cur, nxt, x1);
+				sound_pos_render(s, &lis0, &lis1, f, n);
+			} else {
+				sound_render(s, f, n);
+			}
+
+			sound_mix(a->buffer + j, f, n);
 		}
 	}
+	/* once for every voice */
+	sound_volume(a->buffer, a->size, lvol, nvol);
 	if (a->size > 0) {
 		g_state->cur_listener = nxt;
 		lvol = nvol;
@@ -840,6 +969,7 @@ void
 game_step(struct game_memory *memory, struct input *input, struct audio *audio)
 {
 	double t1 = io.get_time();
+	struct wav *theme;
 	g_state = memory->state.base;
 	g_asset = memory->asset.base;
 	g_input = input;
@@ -850,14 +980,19 @@ game_step(struct game_memory *memory, struct input *input, struct audio *audio)
 	camera_set_ratio(&g_state->player_cam, (float)input->width / (float)input->height);
 
 	memory->scrap.used = 0;
-	sys_render_init(memory_zone_init(mempush(&memory->scrap, SZ_4M), SZ_4M));
+	sys_render_init(memory_zone_init(mempush(&memory->scrap, SZ_16M), SZ_16M));
 	gui_begin(g_state->gui);
 
 	if (on_pressed('X')) {
 		g_state->debug = !g_state->debug;
+		game_asset_preload(g_asset, MANIFEST_DEBUG);
+	}
+	if (on_pressed('M')) {
+		game_asset_report(g_asset);
 	}
 	if (on_pressed('R')) {
 		game_gen_map(&g_state->map);
+		g_state->shadow_dirty = 1;
 	}
 	if (on_pressed('Z')) {
 		g_state->flycam = !g_state->flycam;
@@ -885,10 +1020,17 @@ game_step(struct game_memory *memory, struct input *input, struct audio *audio)
 	light_set_pos(&g_state->light, pos);
 	dbg_light_mark(&g_state->light);
 
+	/* the map submission depends on both the camera and the sun */
+	render_update_shadow(&g_state->cam, &g_state->light);
+	game_render();
 	sys_render_exec();
 	audio_set_listener(g_state->cam.position,
                                vec3_normalize(camera_get_dir(&g_state->cam)),
                                vec3_normalize(camera_get_left(&g_state->cam)));
+	/* the theme is bound once loaded, the placeholder plays meanwhile */
+	theme = game_get_wav(g_asset, WAV_THEME);
+	if (g_state->sound[0].sampler.wav != theme)
+		sound_init(&g_state->sound[0], theme, LOOP, TRIG, 0, (vec3){0.,0.,0.});
 	do_audio(audio);
 
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
@@ -899,9 +1041,14 @@ game_step(struct game_memory *memory, struct input *input, struct audio *audio)
 	gui_begin(g_state->gui);
 	show_fps(1.0/g_input->dt);
 	show_ms((io.get_time() - t1) * 1000.0);
+	/* assets missing from the manifests */
+	if (g_asset->lazy_loads)
+		gui_printf(g_input->width - 128, g_input->height - 96, "%lu lazy loads", g_asset->lazy_loads);
 	if (g_state->debug)
 		gui_draw();
 
-	game_asset_poll(g_asset);
+	/* static shadows were drawn without the meshes still loading */
+	if (game_asset_poll(g_asset))
+		g_state->shadow_dirty = 1;
 }
 
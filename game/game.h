@@ -7,6 +7,10 @@
 typedef int64_t (file_size_t)(const char *path);
 typedef int64_t (file_read_t)(const char *path, void *buf, size_t size);
 typedef time_t (file_time_t)(const char *path);
+typedef void *(file_map_t)(const char *path, size_t *size);
+typedef void (file_unmap_t)(void *addr, size_t size);
+typedef int (file_watch_t)(const char *path);
+typedef const char *(file_changed_t)(void);
 typedef void (window_close_t)(void);
 typedef void (window_cursor_t)(int show);
 typedef double (window_time_t)(void);
@@ -14,6 +18,10 @@ struct io {
 	file_size_t *file_size;
 	file_read_t *file_read;
 	file_time_t *file_time;
+	file_map_t *file_map; /* read-only, NULL on failure */
+	file_unmap_t *file_unmap;
+	file_watch_t *file_watch; /* report changes through file_changed */
+	file_changed_t *file_changed; /* next changed file, NULL if none */
 	window_close_t *close;  /* request window to be closed */
 	window_cursor_t *show_cursor; /* request cursor to be shown */
 	window_time_t *get_time;
@@ -24,26 +32,30 @@ struct game_memory {
 	struct memory_zone asset;
 	struct memory_zone scrap;
 	struct memory_zone audio;
+	int telemetry; /* print the asset loads once warmed up */
 };
 
 /* typedef for function type */
 typedef void (game_init_t)(struct game_memory *memory);
 typedef void (game_step_t)(struct game_memory *memory, struct input *input, struct audio *audio);
 typedef void (game_fini_t)(struct game_memory *memory);
+typedef void (game_unload_t)(struct game_memory *memory);
 
 /* declare functions signature */
 game_init_t game_init;
 game_step_t game_step;
 game_fini_t game_fini;
+game_unload_t game_unload;
 
 struct system {
 	struct memory_zone zone;
-	struct list list;
+	struct cmdbuf cmds;
 };
 
-void sys_init(struct system *sys, struct memory_zone zone);
+void sys_init(struct system *sys, struct memory_zone zone, size_t size);
 
 #include "asset.h"
+#include "render.h"
 #include "entity.h"
 #include "gui.h"
 #include "sound.h"
@@ -55,9 +67,21 @@ struct ent {
 	quaternion rot;
 };
 
+#define MAP_SIZE 500.0
+#define MAP_GRID 32 /* cells per side */
+#define MAP_FOG_DIST 40.0 /* nothing is visible past it, see res/test.frag */
+
+/* ents are sorted by cell, a cell hold a range in each ent array */
+struct map_cell {
+	uint16_t rocks, rock_count;
+	uint16_t small, small_count;
+	float scale; /* largest ent scale in the cell */
+};
+
 struct map {
 	struct ent rocks[4096];
 	struct ent small[4096];
+	struct map_cell cells[MAP_GRID][MAP_GRID];
 };
 
 #define NB_SOUND 1
@@ -87,12 +111,18 @@ struct game_state {
 	} options;
 
 	int debug;
-	struct camera sun;
+	int telemetry;
+	double warmup; /* start time of the warm up */
 
 	struct light light;
-	struct texture depth;
-	unsigned int depth_fbo;
+	struct shadow_cascade cascades[SHADOW_CASCADES];
+	mat4 shadow_mat[SHADOW_CASCADES];
+	float shadow_far[SHADOW_CASCADES];
+	vec2 shadow_bias[SHADOW_CASCADES]; /* constant and per slope, in map depth */
+	int shadow_dirty; /* force an update of every cascade */
+	unsigned int inst_vbo;
 	struct system sys_render;
+	struct render_stats render_stats;
 
 	vec3 player_pos;
 	struct camera player_cam;
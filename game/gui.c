@@ -250,7 +250,7 @@ gui_init(void *ctx)
 		"	if (texture(t_shape, v_shape).r < 0.5) discard;\n"
 		"	out_color = vec4(texture(t_color, v_color).rgb, 1.0);\n"
 		"}\n";
-	int n = shader_reload(&gui->shader, vert, frag, NULL);
+	int n = shader_reload(&gui->shader, "gui", vert, frag, NULL);
 	if (n)
 		die("failed to load gui shader\n");
 #endif
@@ -357,14 +357,16 @@ gui_draw(void)
 	struct gui_rect r, clip = { 0, 0, w, h };
 	struct gui_quad q;
 	struct shader *s = game_get_shader(g_asset, SHADER_GUI);
-	GLuint prog = s->prog;
+	GLuint prog;
 	GLint utex;
 	struct texture *tex_color = &gui->tex_color;
 	struct texture *tex_shape = game_get_texture(g_asset, TEXTURE_GUI_SHAPE);
 
-	if (gui->cmd_queue_size == 0)
+	/* the shader may still be loading */
+	if (gui->cmd_queue_size == 0 || !s)
 		return;
 
+	prog = s->prog;
 	glUseProgram(prog);
 
 	utex = glGetUniformLocation(prog, "t_shape");
@@ -1,36 +1,84 @@
+#include <float.h>
 #include <stdio.h>
+#include <string.h>
 #include "game.h"
 #include "render.h"
 #include "asset.h"
 
+#define RENDER_MAX_TEXTURE_UNIT 8
+struct material {
+	enum render_layer layer;
+	enum asset_key shader;
+	int shadow; /* drawn in the shadow pass, with the shader depth variant */
+	size_t texture_count;
+	struct {
+		enum shader_uniform uniform;
+		enum asset_key res_id; /* regular or internal texture */
+	} texture[RENDER_MAX_TEXTURE_UNIT];
+};
+
+static const struct material materials[MATERIAL_COUNT] = {
+	[MATERIAL_WORLD] = {
+		RENDER_LAYER_WORLD, SHADER_TEST, 1, 1, {
+			{ SHADER_UNIFORM_SHADOWMAP, INTERNAL_TEXTURE_SHADOWMAP },
+		},
+	},
+	/* only used by debug meshes */
+	[MATERIAL_SOLID] = { RENDER_LAYER_WORLD, SHADER_SOLID, 0, 0 },
+	[MATERIAL_SKY] = { RENDER_LAYER_SKY, SHADER_SKY, 0, 0 },
+	[MATERIAL_DEBUG_TEXTURE] = {
+		RENDER_LAYER_OVERLAY, DEBUG_SHADER_TEXTURE, 0, 1, {
+			{ SHADER_UNIFORM_TEX, INTERNAL_TEXTURE_SHADOWMAP_NEAR },
+		},
+	},
+};
+
+/* resolve a material texture, the shadow map is an array of one
+ * texture per cascade */
+static size_t
+material_textures(enum asset_key id, struct texture **tex)
+{
+	size_t i;
+
+	switch (id) {
+	case INTERNAL_TEXTURE_SHADOWMAP:
+		for (i = 0; i < SHADOW_CASCADES; i++)
+			tex[i] = g_state->cascades[i].map;
+		return SHADOW_CASCADES;
+	case INTERNAL_TEXTURE_SHADOWMAP_NEAR:
+		tex[0] = g_state->cascades[0].map;
+		return 1;
+	default:
+		tex[0] = game_get_texture(g_asset, id);
+		return 1;
+	}
+}
+
 static void
-debug_texture(vec2 size, struct texture *tex)
+debug_texture(vec2 size)
 {
 	float w = size.x / (float)g_state->width;
 	float h = size.y / (float)g_state->height;
 	vec2 at = {-1, 1}; /* top - left */
 
-	sys_render_push(&(struct render_entry){
-			.shader = DEBUG_SHADER_TEXTURE,
+	sys_render_push(&(struct render_cmd){
+			.material = MATERIAL_DEBUG_TEXTURE,
 			.mesh = DEBUG_MESH_CUBE,
 			.scale = {w, h, 0},
 			.position = {at.x + w, at.y - h, -1},
 			.rotation = QUATERNION_IDENTITY,
-			.texture = {
-				{ "tex", INTERNAL_TEXTURE, .tex = tex }
-			},
 		});
 }
 
 
 void
-sys_render_push(struct render_entry *entry)
+sys_render_push(struct render_cmd *cmd)
 {
 	struct system *sys = &g_state->sys_render;
-	struct render_entry *e;
+	struct render_cmd *c;
 
-	e = list_push(&sys->list, &sys->zone, sizeof(*e));
-	*e = *entry;
+	c = cmdbuf_push(&sys->cmds);
+	*c = *cmd;
 }
 
 void
@@ -38,8 +86,8 @@ sys_render_push_vec(vec3 pos, vec3 dir, vec3 color)
 {
 	vec3 x = vec3_add(pos, vec3_mult(1, dir));
 
-	sys_render_push(&(struct render_entry){
-			.shader = SHADER_SOLID,
+	sys_render_push(&(struct render_cmd){
+			.material = MATERIAL_SOLID,
 			.mesh = DEBUG_MESH_CROSS,
 			.scale = {0,0,1},
 			.position = x,
@@ -53,8 +101,8 @@ sys_render_push_bounding(vec3 pos, vec3 scale, struct bounding_volume *bvol)
 {
 	float radius = vec3_max(scale) * bvol->radius;
 
-	sys_render_push(&(struct render_entry){
-			.shader = SHADER_SOLID,
+	sys_render_push(&(struct render_cmd){
+			.material = MATERIAL_SOLID,
 			.mesh = DEBUG_MESH_SPHERE,
 			.scale = vec3_mult(radius, scale),
 			.position = vec3_add(pos, bvol->off),
@@ -66,8 +114,8 @@ sys_render_push_bounding(vec3 pos, vec3 scale, struct bounding_volume *bvol)
 void
 sys_render_push_cross(vec3 at, vec3 scale, vec3 color)
 {
-	sys_render_push(&(struct render_entry){
-			.shader = SHADER_SOLID,
+	sys_render_push(&(struct render_cmd){
+			.material = MATERIAL_SOLID,
 			.mesh = DEBUG_MESH_CROSS,
 			.scale = scale,
 			.position = at,
@@ -86,243 +134,462 @@ render_bind_shader(struct shader *shader)
 void
 render_bind_mesh(struct shader *shader, struct mesh *mesh)
 {
-	GLint position;
-	GLint normal;
-	GLint texcoord;
-
-	position = glGetAttribLocation(shader->prog, "in_pos");
-	normal = glGetAttribLocation(shader->prog, "in_normal");
-	texcoord = glGetAttribLocation(shader->prog, "in_texcoord");
-
-	mesh_bind(mesh, position, normal, texcoord);
+	struct mesh_layout layout = {
+		.position = shader->attrib[SHADER_ATTRIB_POSITION],
+		.normal = shader->attrib[SHADER_ATTRIB_NORMAL],
+		.texcoord = shader->attrib[SHADER_ATTRIB_TEXCOORD],
+		.instance = shader->attrib[SHADER_ATTRIB_MODEL],
+		.instance_vbo = g_state->inst_vbo,
+	};
+
+	mesh_bind(mesh, &layout);
 }
 
 void
 render_bind_camera(struct shader *s, struct camera *c)
 {
-	GLint proj, view;
-
-	proj = glGetUniformLocation(s->prog, "proj");
-	view = glGetUniformLocation(s->prog, "view");
+	GLint proj = s->uniform[SHADER_UNIFORM_PROJ];
+	GLint view = s->uniform[SHADER_UNIFORM_VIEW];
 
-	glUniformMatrix4fv(proj, 1, GL_FALSE, (float *)&c->proj.m);
-	glUniformMatrix4fv(view, 1, GL_FALSE, (float *)&c->view.m);
+	if (proj >= 0)
+		glUniformMatrix4fv(proj, 1, GL_FALSE, (float *)&c->proj.m);
+	if (view >= 0)
+		glUniformMatrix4fv(view, 1, GL_FALSE, (float *)&c->view.m);
 }
 
 void
 render_mesh(struct mesh *mesh)
 {
 	if (mesh->index_count > 0)
-		glDrawElements(mesh->primitive, mesh->index_count, GL_UNSIGNED_INT, 0);
+		glDrawElements(mesh->primitive, mesh->index_count, mesh->index_type, 0);
 	else
 		glDrawArrays(mesh->primitive, 0, mesh->vertex_count);
 }
 
-static int
-frustum_cull(vec4 frustum[6], struct mesh *mesh, vec3 pos, vec3 scale)
+void
+render_mesh_instanced(struct mesh *mesh, size_t count)
+{
+	if (mesh->index_count > 0)
+		glDrawElementsInstanced(mesh->primitive, mesh->index_count, mesh->index_type, 0, count);
+	else
+		glDrawArraysInstanced(mesh->primitive, 0, mesh->vertex_count, count);
+}
+
+/* world space bounding spheres of the commands, split by component */
+struct render_spheres {
+	float *x, *y, *z, *r;
+};
+
+static void
+render_spheres_init(struct render_spheres *sph, struct memory_zone *zone,
+		    struct render_cmd *cmds, size_t count)
+{
+	enum asset_key last_mesh = ASSET_KEY_COUNT;
+	struct mesh *mesh = NULL;
+	size_t i;
+
+	sph->x = mempush(zone, count * sizeof(float));
+	sph->y = mempush(zone, count * sizeof(float));
+	sph->z = mempush(zone, count * sizeof(float));
+	sph->r = mempush(zone, count * sizeof(float));
+
+	for (i = 0; i < count; i++) {
+		struct render_cmd *c = &cmds[i];
+		vec3 pos;
+
+		if (!(c->flags & RENDER_CULL)) {
+			/* never culled */
+			sph->x[i] = sph->y[i] = sph->z[i] = 0;
+			sph->r[i] = FLT_MAX;
+			continue;
+		}
+		if (!mesh || last_mesh != c->mesh) {
+			last_mesh = c->mesh;
+			mesh = game_get_mesh(g_asset, c->mesh);
+		}
+
+		/* move the sphere center to the object position */
+		pos = vec3_fma(c->scale, mesh->bounding.off, c->position);
+		sph->x[i] = pos.x;
+		sph->y[i] = pos.y;
+		sph->z[i] = pos.z;
+		sph->r[i] = vec3_max(c->scale) * mesh->bounding.radius;
+	}
+}
+
+/* cascades cover the view frustum up to far, the fog hides the rest */
+static const struct {
+	float far;
+	size_t size;
+	GLenum format;
+} cascade_conf[SHADOW_CASCADES] = {
+	{ 8.0, 1024, GL_DEPTH_COMPONENT24 },
+	{ 20.0, 1024, GL_DEPTH_COMPONENT24 },
+	{ MAP_FOG_DIST, 1024, GL_DEPTH_COMPONENT16 },
+};
+
+/* distance from the light origin to the cascade center, casters are
+ * searched up to there */
+#define SHADOW_PULLBACK 50.0
+
+/* depth resolution of a shadow map format, float maps are limited by
+ * their mantissa near 1 */
+static float
+shadow_depth_step(GLenum format)
 {
-	vec3 center = mesh->bounding.off;
-	float radius = vec3_max(scale) * mesh->bounding.radius;
+	switch (format) {
+	case GL_DEPTH_COMPONENT16:
+		return 1.0 / 65535.0;
+	case GL_DEPTH_COMPONENT24:
+		return 1.0 / 16777215.0;
+	default:
+		return 1.0 / 16777216.0;
+	}
+}
+
+/* maximum number of instances submitted by a single instanced draw */
+#define RENDER_BATCH_MAX 4096
 
-	/* move the sphere center to the object position */
-	pos = vec3_fma(scale, center, pos);
+struct render_key {
+	uint64_t key;
+	struct render_cmd *cmd;
+};
 
-	return sphere_outside_frustum(frustum, pos, radius);
+struct render_batch {
+	struct render_cmd *cmd; /* first command, hold the batch's state */
+	int shadow; /* shadow pass, draw with the depth only variants */
+	size_t count;
+	mat4 *model;
+};
+
+enum render_pass_type {
+	RENDER_PASS_MAIN,
+	RENDER_PASS_SHADOW_STATIC,
+	RENDER_PASS_SHADOW_DYNAMIC,
+};
+
+static int
+render_cmd_caster(struct render_cmd *c)
+{
+	return materials[c->material].shadow && !(c->flags & RENDER_NO_SHADOW);
+}
+
+static int
+render_cmd_batchable(struct render_cmd *a, struct render_cmd *b)
+{
+	return a->material == b->material && a->mesh == b->mesh &&
+		a->color.x == b->color.x && a->color.y == b->color.y && a->color.z == b->color.z;
 }
 
 static void
-render_pass(struct camera cam, int do_frustum_cull)
+render_batch_flush(struct render_batch *batch, struct camera *cam, struct shader **cur_shader, struct mesh **cur_mesh)
 {
-	struct system *sys = &g_state->sys_render;
 	struct game_state *game_state = g_state;
 	struct game_asset *game_asset = g_asset;
-	struct camera *sun = &game_state->sun;
 	struct light *light = &game_state->light;
-	enum asset_key last_shader = ASSET_KEY_COUNT;
-	enum asset_key last_mesh = ASSET_KEY_COUNT;
+	struct render_cmd *c = batch->cmd;
+	const struct material *mat = &materials[c->material];
+	struct shader *shader;
+	struct mesh *mesh;
+	size_t i, j, unit;
+
+	if (batch->count == 0)
+		return;
+
+	if (batch->shadow)
+		shader = game_get_shader_depth(game_asset, mat->shader);
+	else
+		shader = game_get_shader(game_asset, mat->shader);
+	if (!shader) {
+		batch->count = 0;
+		return;
+	}
+	mesh = game_get_mesh(game_asset, c->mesh);
+
+	if (*cur_shader != shader) {
+		*cur_shader = shader;
+		render_bind_shader(shader);
+		render_bind_camera(shader, cam);
+		/* mesh need to be bind again */
+		*cur_mesh = NULL;
+	}
+	if (*cur_mesh != mesh) {
+		*cur_mesh = mesh;
+		render_bind_mesh(shader, mesh);
+	}
+
+	GLint *loc = shader->uniform;
+	if (loc[SHADER_UNIFORM_TIME] >= 0)
+		glUniform1f(loc[SHADER_UNIFORM_TIME], g_input->time);
+
+	if (loc[SHADER_UNIFORM_CAMP] >= 0)
+		glUniform3f(loc[SHADER_UNIFORM_CAMP], cam->position.x, cam->position.y, cam->position.z);
+
+	if (loc[SHADER_UNIFORM_LIGHTD] >= 0)
+		glUniform3f(loc[SHADER_UNIFORM_LIGHTD],
+			    light->dir.x,
+			    light->dir.y,
+			    light->dir.z);
+
+	if (loc[SHADER_UNIFORM_LIGHTC] >= 0)
+		glUniform4f(loc[SHADER_UNIFORM_LIGHTC],
+			    light->col.x,
+			    light->col.y,
+			    light->col.z,
+			    light->col.w
+			);
+
+	if (loc[SHADER_UNIFORM_LSMAT] >= 0)
+		glUniformMatrix4fv(loc[SHADER_UNIFORM_LSMAT], SHADOW_CASCADES, GL_FALSE,
+				   (float *)game_state->shadow_mat);
+
+	if (loc[SHADER_UNIFORM_CASCADE] >= 0)
+		glUniform1fv(loc[SHADER_UNIFORM_CASCADE], SHADOW_CASCADES, game_state->shadow_far);
+
+	if (loc[SHADER_UNIFORM_BIAS] >= 0)
+		glUniform2fv(loc[SHADER_UNIFORM_BIAS], SHADOW_CASCADES, (float *)game_state->shadow_bias);
+
+	if (loc[SHADER_UNIFORM_COLOR] >= 0)
+		glUniform3f(loc[SHADER_UNIFORM_COLOR], c->color.x, c->color.y, c->color.z);
+
+	if (loc[SHADER_UNIFORM_RESOLUTION] >= 0)
+		glUniform2f(loc[SHADER_UNIFORM_RESOLUTION], game_state->width, game_state->height);
+
+	if (loc[SHADER_UNIFORM_THICKNESS] >= 0)
+		glUniform1f(loc[SHADER_UNIFORM_THICKNESS], 0.93);
+
+	for (i = 0, unit = 0; i < mat->texture_count; i++) {
+		GLint tex_loc = loc[mat->texture[i].uniform];
+		struct texture *tex[RENDER_MAX_TEXTURE_UNIT];
+		GLint units[RENDER_MAX_TEXTURE_UNIT];
+		size_t n;
+
+		if (tex_loc < 0)
+			continue;
+		n = material_textures(mat->texture[i].res_id, tex);
+		for (j = 0; j < n; j++, unit++) {
+			units[j] = unit;
+			glActiveTexture(GL_TEXTURE0 + unit);
+			glBindTexture(tex[j]->type, tex[j]->id);
+		}
+		glUniform1iv(tex_loc, n, units);
+	}
+
+	if (shader->attrib[SHADER_ATTRIB_MODEL] >= 0) {
+		/* orphan the previous storage and stream this batch's matrices,
+		 * the mesh vertex array already points to this buffer */
+		glBindBuffer(GL_ARRAY_BUFFER, game_state->inst_vbo);
+		glBufferData(GL_ARRAY_BUFFER, batch->count * sizeof(mat4), batch->model, GL_STREAM_DRAW);
+
+		render_mesh_instanced(mesh, batch->count);
+		g_state->render_stats.draws++;
+	} else {
+		/* shader without instanced input, fallback to one draw per instance */
+		GLint model = loc[SHADER_UNIFORM_MODEL];
+		for (i = 0; i < batch->count; i++) {
+			if (model >= 0)
+				glUniformMatrix4fv(model, 1, GL_FALSE, (float *)&batch->model[i].m);
+			render_mesh(mesh);
+			g_state->render_stats.draws++;
+		}
+	}
+
+	batch->count = 0;
+}
+
+/* return the number of instances drawn */
+static size_t
+render_pass(struct camera cam, struct render_cmd *cmds, struct render_spheres *sph,
+	    size_t count, enum render_pass_type pass)
+{
+	struct system *sys = &g_state->sys_render;
+	struct memory_zone mem_state = sys->zone; /* save memory state */
 	struct shader *shader = NULL;
-	struct mesh *mesh = NULL;
+	struct mesh *bound_mesh = NULL;
+	struct render_batch batch = { 0 };
 	mat4 vm = mat4_mult_mat4(&cam.proj, &cam.view);
 	vec4 frustum[6];
-	struct link *link;
+	uint32_t *visible;
+	size_t i, drawn = 0;
 
-	mat4_projection_frustum(&vm, frustum);
-	for (link = sys->list.first; link != NULL; link = link->next) {
-		struct render_entry e = *(struct render_entry *)link->data;
+	batch.shadow = pass != RENDER_PASS_MAIN;
+	batch.model = mempush(&sys->zone, RENDER_BATCH_MAX * sizeof(mat4));
+	visible = mempush(&sys->zone, (count + 31) / 32 * sizeof(*visible));
 
-		if (!mesh || last_mesh != e.mesh)
-			mesh = game_get_mesh(game_asset, e.mesh);
+	mat4_projection_frustum(&vm, frustum);
+	spheres_in_frustum(frustum, sph->x, sph->y, sph->z, sph->r, count, visible);
+	for (i = 0; i < count; i++) {
+		struct render_cmd *c = &cmds[i];
 
-		if (do_frustum_cull && e.cull && frustum_cull(frustum, mesh, e.position, e.scale))
+		if (!(visible[i / 32] & (1u << (i % 32))))
 			continue;
-
-		if (!shader || last_shader != e.shader) {
-			last_shader = e.shader;
-			shader = game_get_shader(game_asset, e.shader);
-			render_bind_shader(shader);
-			render_bind_camera(shader, &cam);
-			/* mesh need to be bind again */
-			last_mesh = e.mesh;
-			render_bind_mesh(shader, mesh);
-		} else if (last_mesh != e.mesh) {
-			last_mesh = e.mesh;
-			render_bind_mesh(shader, mesh);
+		if (pass != RENDER_PASS_MAIN) {
+			if (!render_cmd_caster(c))
+				continue;
+			if ((pass == RENDER_PASS_SHADOW_STATIC) != !!(c->flags & RENDER_STATIC))
+				continue;
 		}
 
-		mat4 transform = mat4_transform_scale(e.position,
-						      e.rotation,
-						      e.scale);
-
-		GLint model = glGetUniformLocation(shader->prog, "model");
-		if (model >= 0)
-			glUniformMatrix4fv(model, 1, GL_FALSE, (float *)&transform.m);
-
-		GLint time = glGetUniformLocation(shader->prog, "time");
-		if (time >= 0)
-			glUniform1f(time, g_input->time);
-
-		GLint camp = glGetUniformLocation(shader->prog, "camp");
-		if (camp >= 0)
-			glUniform3f(camp, cam.position.x, cam.position.y, cam.position.z);
-
-		GLint lightd = glGetUniformLocation(shader->prog, "lightd");
-		if (lightd >= 0)
-			glUniform3f(lightd,
-				    light->dir.x,
-				    light->dir.y,
-				    light->dir.z);
-
-		GLint lightc = glGetUniformLocation(shader->prog, "lightc");
-		if (lightc >= 0)
-			glUniform4f(lightc,
-				    light->col.x,
-				    light->col.y,
-				    light->col.z,
-				    light->col.w
-				);
-		GLint lsview = glGetUniformLocation(shader->prog, "lsview");
-		if (lsview >= 0)
-			glUniformMatrix4fv(lsview, 1, GL_FALSE, (float *) sun->view.m);
-
-		GLint lsproj = glGetUniformLocation(shader->prog, "lsproj");
-		if (lsproj >= 0)
-			glUniformMatrix4fv(lsproj, 1, GL_FALSE, (float *) sun->proj.m);
-
-		GLint color = glGetUniformLocation(shader->prog, "color");
-		if (color >= 0)
-			glUniform3f(color, e.color.x, e.color.y, e.color.z);
-
-		GLint v2res = glGetUniformLocation(shader->prog, "v2Resolution");
-		if (v2res >= 0)
-			glUniform2f(v2res, game_state->width, game_state->height);
-
-		GLint thick = glGetUniformLocation(shader->prog, "thickness");
-		if (thick >= 0)
-			glUniform1f(v2res, 0.93);
-
-		int unit;
-		for (unit = 0; unit < RENDER_MAX_TEXTURE_UNIT; unit++) {
-			if (e.texture[unit].name == NULL)
-				break;
-			const char *name = e.texture[unit].name;
-			enum asset_key id = e.texture[unit].res_id;
-			GLint tex_loc = glGetUniformLocation(shader->prog, name);
-			if (tex_loc) {
-				struct texture *tex_res = e.texture[unit].tex;
-				if (id < ASSET_KEY_COUNT)
-					tex_res = game_get_texture(game_asset, id);
-
-				glActiveTexture(GL_TEXTURE0 + unit);
-				glUniform1i(tex_loc, unit);
-				glBindTexture(tex_res->type, tex_res->id);
-			}
-		}
+		/* merge consecutive commands sharing the same state into one draw */
+		if (batch.count > 0 && (batch.count == RENDER_BATCH_MAX ||
+					!render_cmd_batchable(batch.cmd, c)))
+			render_batch_flush(&batch, &cam, &shader, &bound_mesh);
 
-		if (e.count == 0) {
-//			glDisable(GL_CULL_FACE);
-			render_mesh(mesh);
-		} else {
-#if 0
-			GLuint vbo;
-			GLint id;
-			glGenBuffers(1, &vbo);
-			glBindBuffer(GL_ARRAY_BUFFER, vbo);
-			glBufferData(GL_ARRAY_BUFFER, e.count * sizeof(vec4), e.inst, GL_STREAM_DRAW);
-
-#define OFFSET(Struct, Member) \
-      (void*)(&((Struct*)NULL)->Member)
-
-			id = glGetAttribLocation(shader->prog, "it_pos");
-			if (id >= 0) {
-				glEnableVertexAttribArray(id);
-				glBindBuffer(GL_ARRAY_BUFFER, vbo);
-				glVertexAttribPointer(id, 3, GL_FLOAT, GL_FALSE, 4 * sizeof(float), OFFSET(vec4, x));
-				glVertexAttribDivisor(id, 1);
-			}
-			id = glGetAttribLocation(shader->prog, "it_scale");
-			if (id >= 0) {
-				glEnableVertexAttribArray(id);
-				glBindBuffer(GL_ARRAY_BUFFER, vbo);
-				glVertexAttribPointer(id, 1, GL_FLOAT, GL_FALSE, 4 * sizeof(float), OFFSET(vec4, w));
-				glVertexAttribDivisor(id, 1);
-			}
-			glDisable(GL_CULL_FACE); /* TODO: only needed for the grass right now */
-			glDrawArraysInstanced(mesh->primitive, 0, mesh->vertex_count, e.count);
-			glEnable(GL_CULL_FACE);
-			glBufferData(GL_ARRAY_BUFFER, e.count * sizeof(vec4), NULL, GL_STREAM_DRAW);
-			glDeleteBuffers(1, &vbo);
-#undef OFFSET
-#endif
-		}
+		if (batch.count == 0)
+			batch.cmd = c;
+		batch.model[batch.count++] = mat4_transform_scale(c->position, c->rotation, c->scale);
+		drawn++;
 	}
+	render_batch_flush(&batch, &cam, &shader, &bound_mesh);
+
+	/* restore memory zone */
+	sys->zone = mem_state;
+
+	return drawn;
 }
 
+/* 0..1 to max, out of range components and NaN are clamped */
+static uint64_t
+render_color_quantize(float x, uint32_t max)
+{
+	if (!(x > 0))
+		return 0;
+	if (x >= 1)
+		return max;
+	return (uint32_t)(x * max + 0.5f);
+}
 
+/* 5:6:5 RGB, equal colors stay adjacent after the sort */
+static uint64_t
+render_color_key(vec3 c)
+{
+	return render_color_quantize(c.x, 31) << 11 |
+	       render_color_quantize(c.y, 63) << 5 |
+	       render_color_quantize(c.z, 31);
+}
 
-void
-sys_render_init(struct memory_zone zone)
+/* Sort key layout, most significant bits first:
+ *   63..60  layer
+ *   59..52  material
+ *   51..44  mesh
+ *   43..28  color, 5:6:5 RGB
+ *   27..20  unused
+ *   19..4   depth bucket, front to back
+ */
+static uint64_t
+render_sort_key(struct render_cmd *c, vec3 eye)
 {
-	struct system *sys = &g_state->sys_render;
-	sys_init(sys, zone);
-#if 0
-	if (1 && g_state->depth_fbo != 0) {
-		/* Free texture */
-		delete_tex(&g_state->depth);
-
-		/* Free the framebuffer */
-		glDeleteFramebuffers(1, &g_state->depth_fbo);
-		g_state->depth_fbo = 0;
+	uint64_t key = 0;
+	float dist = vec3_dist(c->position, eye);
+	uint64_t depth = MIN(dist * 64.0, 0xffff);
+
+	key |= (uint64_t)(materials[c->material].layer & 0xf) << 60;
+	key |= (uint64_t)c->material << 52;
+	key |= (uint64_t)c->mesh << 44;
+	key |= render_color_key(c->color) << 28;
+	key |= (depth & 0xffff) << 4;
+
+	return key;
+}
+
+/* LSD radix sort on 8 bits digits, stable, digits shared by every key
+ * are skipped. The sorted keys are left in keys. */
+static void
+render_sort(struct render_key *keys, struct render_key *tmp, size_t count)
+{
+	struct render_key *src = keys, *dst = tmp, *swp;
+	size_t hist[256];
+	size_t i, sum, n;
+	int shift;
+
+	for (shift = 0; shift < 64; shift += 8) {
+		memset(hist, 0, sizeof(hist));
+		for (i = 0; i < count; i++)
+			hist[(src[i].key >> shift) & 0xff]++;
+		if (count == 0 || hist[(src[0].key >> shift) & 0xff] == count)
+			continue; /* every key have the same digit */
+
+		for (i = 0, sum = 0; i < 256; i++) {
+			n = hist[i];
+			hist[i] = sum;
+			sum += n;
+		}
+		for (i = 0; i < count; i++)
+			dst[hist[(src[i].key >> shift) & 0xff]++] = src[i];
+
+		swp = src;
+		src = dst;
+		dst = swp;
 	}
-#endif
-	if (g_state->depth_fbo != 0)
-		return;
 
-	struct texture *depth = &g_state->depth;
-	size_t size = 1024*4;
-	*depth = create_2d_tex(size, size, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	if (src != keys)
+		memcpy(keys, src, count * sizeof(*keys));
+}
+
+static size_t
+render_state_changes(struct render_key *keys, size_t count)
+{
+	size_t i, changes = 0;
+
+	for (i = 0; i < count; i++)
+		if (i == 0 || !render_cmd_batchable(keys[i - 1].cmd, keys[i].cmd))
+			changes++;
+
+	return changes;
+}
+
+static void
+shadow_target_init(struct texture *depth, unsigned int *fbo, size_t size, GLenum format)
+{
+	/* outside of the map is never in shadow */
+	const float border[4] = { 1, 1, 1, 1 };
+
+	*depth = create_depth_tex(size, size, format);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+	glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, border);
 
-	glGenFramebuffers(1, &g_state->depth_fbo);
-	glBindFramebuffer(GL_FRAMEBUFFER, g_state->depth_fbo);
+	glGenFramebuffers(1, fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, *fbo);
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depth->id, 0);
 	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
 		printf("Error framebuffer incomplete\n");
 	}
 }
 
+void
+sys_render_init(struct memory_zone zone)
+{
+	struct system *sys = &g_state->sys_render;
+	size_t i;
+
+	sys_init(sys, zone, sizeof(struct render_cmd));
+	if (g_state->cascades[0].fbo != 0)
+		return;
+
+	glGenBuffers(1, &g_state->inst_vbo);
+
+	for (i = 0; i < SHADOW_CASCADES; i++) {
+		struct shadow_cascade *c = &g_state->cascades[i];
+		size_t size = cascade_conf[i].size;
+
+		shadow_target_init(&c->depth, &c->fbo, size, cascade_conf[i].format);
+		shadow_target_init(&c->depth_static, &c->static_fbo, size, cascade_conf[i].format);
+		camera_init(&c->cam, 1, 1);
+		c->map = &c->depth_static;
+		c->dirty = 1;
+	}
+}
+
 static void
-camera_update_orth(struct camera *c, int width, int height)
+camera_update_orth(struct camera *c, float extent, float f)
 {
-	float r = 64.0;
-	float t = 64.0;
-	float f = 800.0;//c->zFar;
-	float n = 0.0; //c->zNear;
+	float r = extent;
+	float t = extent;
+	float n = 0.0;
 
+	c->proj = (mat4){ 0 };
 	c->proj.m[0][0] = 1.0 / r;
 	c->proj.m[1][1] = 1.0 / t;
 	c->proj.m[2][2] = -2.0  / (f - n);
@@ -331,21 +598,110 @@ camera_update_orth(struct camera *c, int width, int height)
 	c->proj.m[3][3] = 1.0;
 }
 
+/* Fit each cascade to the bounding sphere of its slice of the view
+ * frustum. The sphere size does not depend on the camera orientation and
+ * the cascade origin only moves by whole groups of texels, the cached
+ * static shadow map stays valid until it does. */
+void
+render_update_shadow(struct camera *cam, struct light *light)
+{
+	float t = tan(cam->fov / 2.0);
+	float k2 = t * t * (1 + cam->ratio * cam->ratio); /* slice corner slope */
+	vec3 dir = vec3_normalize(camera_get_dir(cam));
+	float near = cam->zNear;
+	size_t i;
+
+	for (i = 0; i < SHADOW_CASCADES; i++) {
+		struct shadow_cascade *c = &g_state->cascades[i];
+		float far = cascade_conf[i].far;
+		float z = MIN((far + near) * (1 + k2) / 2, far);
+		float radius = sqrt((far - z) * (far - z) + k2 * far * far);
+		/* keep the sphere inside while the center snaps */
+		float extent = radius * 9.0 / 8.0;
+		/* 1/16 of the map, a whole number of texels */
+		float snap = extent / 8.0;
+		vec3 center = vec3_add(cam->position, vec3_mult(z, dir));
+		vec3 old = c->cam.position;
+		quaternion rot = c->cam.rotation;
+		float old_extent = c->cam.proj.m[0][0];
+		vec3 s, u, f, pos;
+
+		camera_update_orth(&c->cam, extent, SHADOW_PULLBACK + extent);
+		camera_set(&c->cam, center, light->rot);
+
+		/* snap the center along the light axes */
+		u = vec3_normalize(camera_get_up(&c->cam));
+		f = vec3_normalize(camera_get_dir(&c->cam));
+		s = vec3_normalize(vec3_cross(f, u));
+		pos = vec3_mult(snap * roundf(vec3_dot(s, center) / snap), s);
+		pos = vec3_add(pos, vec3_mult(snap * roundf(vec3_dot(u, center) / snap), u));
+		pos = vec3_add(pos, vec3_mult(snap * roundf(vec3_dot(f, center) / snap), f));
+		pos = vec3_add(pos, vec3_mult(-SHADOW_PULLBACK, f));
+		camera_set(&c->cam, pos, light->rot);
+
+		if (memcmp(&old, &c->cam.position, sizeof(old)) != 0 ||
+		    memcmp(&rot, &c->cam.rotation, sizeof(rot)) != 0 ||
+		    old_extent != c->cam.proj.m[0][0] || g_state->shadow_dirty)
+			c->dirty = 1;
+
+		g_state->shadow_mat[i] = mat4_mult_mat4(&c->cam.proj, &c->cam.view);
+		g_state->shadow_far[i] = far;
+		/* two depth steps, plus half a texel of depth per unit of
+		 * slope, the map covers SHADOW_PULLBACK + extent in depth */
+		g_state->shadow_bias[i].x = 2.0 * shadow_depth_step(cascade_conf[i].format);
+		g_state->shadow_bias[i].y = extent / cascade_conf[i].size / (SHADOW_PULLBACK + extent);
+		near = far;
+	}
+	g_state->shadow_dirty = 0;
+}
+
 void
 sys_render_exec(void)
 {
-	struct light *light = &g_state->light;
-//	camera_set(&g_state->sun, (vec3){-13.870439, 27.525631, -11.145432}, (quaternion){ {0.379877, 0.442253, -0.214377}, 0.783676});
+	struct system *sys = &g_state->sys_render;
+	struct render_stats *stats = &g_state->render_stats;
+	struct memory_zone mem_state = sys->zone; /* save memory state */
+	struct render_key *keys, *tmp;
+	struct render_cmd *cmds;
+	struct render_spheres sph;
+	struct cmdbuf_chunk *chunk;
+	size_t i, j, count, dynamic;
+
+	if (g_state->debug) {
+		debug_texture((vec2){200, 200});
+	}
+
+	/* build the sort keys once, both passes are submitted in key order */
+	count = sys->cmds.count;
+	keys = mempush(&sys->zone, count * sizeof(*keys));
+	tmp = mempush(&sys->zone, count * sizeof(*tmp));
+	i = 0;
+	cmdbuf_for_each_chunk(&sys->cmds, chunk) {
+		for (j = 0; j < chunk->count; j++, i++) {
+			keys[i].cmd = cmdbuf_chunk_at(&sys->cmds, chunk, j);
+			keys[i].key = render_sort_key(keys[i].cmd, g_state->cam.position);
+		}
+	}
+
+	stats->cmds = count;
+	stats->draws = 0;
+	if (g_state->debug)
+		stats->changes_unsorted = render_state_changes(keys, count);
 
-	glBindFramebuffer(GL_FRAMEBUFFER, g_state->depth_fbo);
+	render_sort(keys, tmp, count);
 
-//	camera_init(&g_state->sun, 10.0, g_state->depth.width / g_state->depth.height);
-	camera_update_orth(&g_state->sun, g_state->depth.width, g_state->depth.height);
-	camera_set(&g_state->sun, light->pos, light->rot);
+	if (g_state->debug)
+		stats->changes_sorted = render_state_changes(keys, count);
 
-	/* clean depth buffer */
-	glClear(GL_DEPTH_BUFFER_BIT);
-	glViewport(0, 0, g_state->depth.width, g_state->depth.height);
+	/* gather the commands in key order, passes then stream them linearly */
+	cmds = mempush(&sys->zone, count * sizeof(*cmds));
+	for (i = 0; i < count; i++)
+		cmds[i] = *keys[i].cmd;
+	render_spheres_init(&sph, &sys->zone, cmds, count);
+
+	for (i = 0, dynamic = 0; i < count; i++)
+		if (render_cmd_caster(&cmds[i]) && !(cmds[i].flags & RENDER_STATIC))
+			dynamic++;
 
 	glDepthMask(GL_TRUE);
 	glEnable(GL_DEPTH_TEST);
@@ -353,10 +709,31 @@ sys_render_exec(void)
 	glCullFace(GL_FRONT);
 	glEnable(GL_CULL_FACE);
 
-	render_pass(g_state->sun, 1);
+	stats->shadow_update = 0;
+	for (i = 0; i < SHADOW_CASCADES; i++) {
+		struct shadow_cascade *c = &g_state->cascades[i];
+		size_t size = cascade_conf[i].size;
+
+		glViewport(0, 0, size, size);
+		if (c->dirty) {
+			glBindFramebuffer(GL_FRAMEBUFFER, c->static_fbo);
+			glClear(GL_DEPTH_BUFFER_BIT);
+			stats->casters[i] = render_pass(c->cam, cmds, &sph, count, RENDER_PASS_SHADOW_STATIC);
+			stats->shadow_update |= 1 << i;
+			c->dirty = 0;
+		}
 
-	if (g_state->debug) {
-		debug_texture((vec2){200, 200}, &g_state->depth);
+		/* dynamic casters are drawn over a copy of the static shadow map */
+		c->map = &c->depth_static;
+		if (dynamic) {
+			glBindFramebuffer(GL_READ_FRAMEBUFFER, c->static_fbo);
+			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, c->fbo);
+			glBlitFramebuffer(0, 0, size, size, 0, 0, size, size,
+					  GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+			glBindFramebuffer(GL_FRAMEBUFFER, c->fbo);
+			render_pass(c->cam, cmds, &sph, count, RENDER_PASS_SHADOW_DYNAMIC);
+			c->map = &c->depth;
+		}
 	}
 
 	/* Rebind the default framebuffer */
@@ -367,5 +744,17 @@ sys_render_exec(void)
 	glCullFace(GL_BACK);
 	glEnable(GL_CULL_FACE);
 
-	render_pass(g_state->cam, 1);
+	render_pass(g_state->cam, cmds, &sph, count, RENDER_PASS_MAIN);
+
+	if (g_state->debug) {
+		gui_printf(0, 48, "cmds %zu draws %zu", stats->cmds, stats->draws);
+		gui_printf(0, 64, "state changes %zu -> %zu sorted",
+			   stats->changes_unsorted, stats->changes_sorted);
+		for (i = 0; i < SHADOW_CASCADES; i++)
+			gui_printf(0, 80 + 16 * i, "cascade %zu casters %zu %s", i, stats->casters[i],
+				   stats->shadow_update & (1 << i) ? "update" : "cached");
+	}
+
+	/* restore memory zone */
+	sys->zone = mem_state;
 }
@@ -7,29 +7,66 @@ void render_bind_shader(struct shader *shader);
 void render_bind_mesh(struct shader *shader, struct mesh *mesh);
 void render_bind_camera(struct shader *s, struct camera *c);
 void render_mesh(struct mesh *mesh);
+void render_mesh_instanced(struct mesh *mesh, size_t count);
 
-struct render_input {
-	const char *name;
-	enum asset_key res_id;
-	struct texture *tex;
+/* layers are drawn in order, they are the most significant part of the sort key */
+enum render_layer {
+	RENDER_LAYER_WORLD,
+	RENDER_LAYER_SKY,
+	RENDER_LAYER_OVERLAY,
+	RENDER_LAYER_COUNT,
 };
 
-#define RENDER_MAX_TEXTURE_UNIT 8
-struct render_entry {
-	enum asset_key shader;
-	enum asset_key mesh;
-	struct render_input texture[RENDER_MAX_TEXTURE_UNIT];
-	quaternion rotation;
+/* materials are built once: a shader and its texture bindings */
+enum render_material {
+	MATERIAL_WORLD,
+	MATERIAL_SOLID,
+	MATERIAL_SKY,
+	MATERIAL_DEBUG_TEXTURE,
+	MATERIAL_COUNT,
+};
+
+#define RENDER_CULL      (1 << 0)
+#define RENDER_STATIC    (1 << 1) /* never moves, kept in the cached shadow map */
+#define RENDER_NO_SHADOW (1 << 2)
+
+/* draw command, only hold per instance data, keep it small */
+struct render_cmd {
+	uint8_t material; /* enum render_material */
+	uint8_t mesh; /* enum asset_key */
+	uint16_t flags;
+	vec3 color;
 	vec3 position;
 	vec3 scale;
-	vec3 color;
-	int count;
-	vec4 *inst;
-	int cull:1;
+	quaternion rotation;
+};
+
+/* the shadow map is split in cascades fitted to slices of the view
+ * frustum, res/test.frag must agree on the count */
+#define SHADOW_CASCADES 3
+
+struct shadow_cascade {
+	struct camera cam;
+	struct texture depth; /* static and dynamic casters */
+	struct texture depth_static; /* static casters only, see dirty */
+	unsigned int fbo;
+	unsigned int static_fbo;
+	struct texture *map; /* sampled this frame */
+	int dirty;
+};
+
+struct render_stats {
+	size_t cmds;
+	size_t changes_unsorted; /* state changes in push order */
+	size_t changes_sorted; /* state changes in sort key order */
+	size_t draws;
+	int shadow_update; /* bit i: static cascade i rendered this frame */
+	size_t casters[SHADOW_CASCADES]; /* at the last update of each cascade */
 };
 
 void sys_render_init(struct memory_zone zone);
-void sys_render_push(struct render_entry *);
+void sys_render_push(struct render_cmd *);
+void render_update_shadow(struct camera *cam, struct light *light);
 void sys_render_exec(void);
 
 void sys_render_push_cross(vec3 at, vec3 scale, vec3 color);
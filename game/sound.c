@@ -73,3 +73,91 @@ sound_step(struct sound *s)
 	out.r = r;
 	return out;
 }
+
+/* render count frames, split in blocks of interleaved samples */
+void
+sound_render(struct sound *s, struct frame *out, size_t count)
+{
+	sample buf[SOUND_BLOCK];
+	size_t i, n;
+
+	/* a frame is two samples, stereo is rendered in place */
+	if (s->sampler.wav->header.channels != 1) {
+		sampler_render(&s->sampler, &out->l, 2 * count);
+		return;
+	}
+	for (; count; count -= n, out += n) {
+		n = MIN(count, SOUND_BLOCK);
+		sampler_render(&s->sampler, buf, n);
+		for (i = 0; i < n; i++) {
+			out[i].l = buf[i];
+			out[i].r = buf[i];
+		}
+	}
+}
+
+/* gains ramped over frames of SOUND_LANES, fixed size inner loops are
+ * vectorized at -O2 */
+static void
+sound_ramp(struct frame *out, size_t count, float l, float r, float dl, float dr)
+{
+	sample *x = &out->l;
+	sample g[2 * SOUND_LANES], d[2 * SOUND_LANES];
+	size_t i, k;
+
+	for (k = 0; k < SOUND_LANES; k++) {
+		g[2 * k] = l + dl * k;
+		g[2 * k + 1] = r + dr * k;
+		d[2 * k] = dl * SOUND_LANES;
+		d[2 * k + 1] = dr * SOUND_LANES;
+	}
+	for (i = 0; i + SOUND_LANES <= count; i += SOUND_LANES, x += 2 * SOUND_LANES) {
+		for (k = 0; k < 2 * SOUND_LANES; k++) {
+			x[k] *= g[k];
+			g[k] += d[k];
+		}
+	}
+	for (k = 0; i < count; i++, k += 2) {
+		x[k] *= g[k];
+		x[k + 1] *= g[k + 1];
+	}
+}
+
+/* panned for a listener moving from cur to nxt over the block, the
+ * gains are ramped instead of computed per frame */
+void
+sound_pos_render(struct sound *s, struct listener *cur, struct listener *nxt,
+	struct frame *out, size_t count)
+{
+	struct lrcv a = sound_get_panning(s, cur);
+	struct lrcv b = sound_get_panning(s, nxt);
+	float l = (a.l + a.c) * a.v;
+	float r = (a.r + a.c) * a.v;
+
+	sound_render(s, out, count);
+	sound_ramp(out, count, l, r, ((b.l + b.c) * b.v - l) / count, ((b.r + b.c) * b.v - r) / count);
+}
+
+/* scale count frames by a volume going from vol to nvol */
+void
+sound_volume(struct frame *out, size_t count, float vol, float nvol)
+{
+	float d = (nvol - vol) / count;
+
+	sound_ramp(out, count, vol, vol, d, d);
+}
+
+/* add count frames of in to out */
+void
+sound_mix(struct frame *restrict out, const struct frame *restrict in, size_t count)
+{
+	sample *dst = &out->l;
+	const sample *src = &in->l;
+	size_t i, k;
+
+	for (i = 0; i + SOUND_LANES <= 2 * count; i += SOUND_LANES)
+		for (k = 0; k < SOUND_LANES; k++)
+			dst[i + k] += src[i + k];
+	for (; i < 2 * count; i++)
+		dst[i] += src[i];
+}
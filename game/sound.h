@@ -3,6 +3,12 @@
 #include "core/math.h"
 #include "core/wav.h"
 
+#define SOUND_BLOCK 256 /* frames rendered at once */
+#define SOUND_LANES 8 /* frames processed together by the ramps */
+
+/* struct frame is rendered as two interleaved samples */
+typedef char sound_frame_check[sizeof(struct frame) == 2 * sizeof(sample) ? 1 : -1];
+
 struct listener {
 	vec3 pos;
 	vec3 dir;
@@ -20,3 +26,8 @@ void sound_init(struct sound *s, struct wav *wav, int mode, int trig, int is_pos
 int sound_is_positional(struct sound *s);
 struct frame sound_pos_step(struct sound *s, struct listener *lis);
 struct frame sound_step(struct sound *s);
+void sound_render(struct sound *s, struct frame *out, size_t count);
+void sound_pos_render(struct sound *s, struct listener *cur, struct listener *nxt,
+	struct frame *out, size_t count);
+void sound_volume(struct frame *out, size_t count, float vol, float nvol);
+void sound_mix(struct frame *out, const struct frame *in, size_t count);
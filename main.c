@@ -9,14 +9,16 @@
 #include "core/engine.h"
 #include "game/game.h"
 #include "plat/core.h"
+#include "plat/pack.h"
+#include "plat/watch.h"
 #include "plat/audio.h"
 #include "plat/libgame.h"
 
-#define MSEC_PER_SEC 1000
 static double
 window_get_time(void)
 {
-	return SDL_GetTicks() / (double) MSEC_PER_SEC;
+	/* high resolution, also used to time loads */
+	return SDL_GetPerformanceCounter() / (double) SDL_GetPerformanceFrequency();
 }
 
 static double
@@ -337,14 +339,33 @@ alloc_game_memory(struct game_memory *memory)
 {
 	memory->state = alloc_memory_zone(NULL, SZ_4M, SZ_16M);
 	memory->scrap = alloc_memory_zone(NULL, SZ_4M, SZ_256M);
-	memory->asset = alloc_memory_zone(NULL, SZ_4M, SZ_16M);
+	memory->asset = alloc_memory_zone(NULL, SZ_4M, SZ_64M);
 	memory->audio = alloc_memory_zone(NULL, SZ_4M, SZ_256M);
 }
 
+/* resources the game watched, drained by the game every frame */
+static struct watch asset_watch;
+
+static int
+asset_watch_add(const char *path)
+{
+	return watch_add(&asset_watch, path);
+}
+
+static const char *
+asset_watch_next(void)
+{
+	return watch_next(&asset_watch);
+}
+
 struct io io = {
 	.file_size = file_size,
 	.file_read = file_read,
 	.file_time = file_time,
+	.file_map = file_map,
+	.file_unmap = file_unmap,
+	.file_watch = asset_watch_add,
+	.file_changed = asset_watch_next,
 	.close = request_close,
 	.show_cursor = request_cursor,
 	.get_time = window_get_time,
@@ -362,6 +383,7 @@ main_loop_step(void)
 	game_audio.buffer = ring_buffer_write_addr(&audio_state.buffer);
 
 	swap_input(&game_input, &game_input_next);
+	watch_poll(&asset_watch);
 	if (libgame.step)
 		libgame.step(&game_memory, &game_input, &game_audio);
 
@@ -387,6 +409,13 @@ main(int argc, char **argv)
 	}
 
 	alloc_game_memory(&game_memory);
+	/* print asset load times, to track the cold start */
+	if (argc == 2 && strcmp(argv[1], "-t") == 0)
+		game_memory.telemetry = 1;
+
+	/* optional, installed builds ship their resources in it */
+	pack_open(PACK_FILE);
+	watch_init(&asset_watch);
 
 	libgame_init(&libgame);
 
@@ -399,8 +428,11 @@ main(int argc, char **argv)
 	audio_init(&audio_state);
 
 	while (!window_should_close()) {
-		if (libgame_changed(&libgame))
+		if (libgame_changed(&libgame)) {
+			if (libgame.unload)
+				libgame.unload(&game_memory);
 			libgame_reload(&libgame);
+		}
 		main_loop_step();
 		rate_limit(300);
 	}
@@ -408,6 +440,7 @@ main(int argc, char **argv)
 	if (libgame.fini)
 		libgame.fini(&game_memory);
 
+	watch_fini(&asset_watch);
 	window_fini();
 
 	audio_fini(&audio_state);
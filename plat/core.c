@@ -4,7 +4,12 @@
 #include <stdio.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#ifndef WINDOWS
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 #include "plat/core.h"
+#include "plat/pack.h"
 
 void *
 xvmalloc(void *base, size_t align, size_t size)
@@ -20,14 +25,91 @@ xvmalloc(void *base, size_t align, size_t size)
 	return addr;
 }
 
+/* resource pack mapped by pack_open(), loose files take precedence */
+static struct {
+	char *data;
+	size_t size;
+	time_t time;
+	const struct pack_header *hdr;
+	const struct pack_entry *entries;
+	const char *names;
+} pack;
+
+static const struct pack_entry *
+pack_find(const char *path)
+{
+	size_t lo = 0, hi;
+	int cmp;
+
+	if (!pack.hdr || !path)
+		return NULL;
+
+	hi = pack.hdr->count;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+
+		cmp = strcmp(path, pack.names + pack.entries[mid].name);
+		if (cmp == 0)
+			return &pack.entries[mid];
+		if (cmp < 0)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+
+	return NULL;
+}
+
+/* return 0 if the pack is missing or invalid, the game then only reads
+ * loose files */
+int
+pack_open(const char *path)
+{
+	const struct pack_header *hdr;
+	size_t i, size = 0;
+	char *data;
+
+	data = file_map(path, &size);
+	if (!data)
+		return 0;
+
+	hdr = (void *)data;
+	if (size < sizeof(*hdr) || hdr->magic != PACK_MAGIC || hdr->version != PACK_VERSION ||
+	    hdr->names_offset < sizeof(*hdr) + (uint64_t)hdr->count * sizeof(struct pack_entry) ||
+	    hdr->names_offset + hdr->names_size > size || hdr->names_size == 0 ||
+	    data[hdr->names_offset + hdr->names_size - 1] != '\0')
+		goto invalid;
+	for (i = 0; i < hdr->count; i++) {
+		const struct pack_entry *e = (void *)(data + sizeof(*hdr) + i * sizeof(*e));
+		if (e->name >= hdr->names_size || e->offset > size || e->size > size - e->offset)
+			goto invalid;
+	}
+
+	pack.data = data;
+	pack.size = size;
+	pack.time = file_time(path);
+	pack.hdr = hdr;
+	pack.entries = (void *)(data + sizeof(*hdr));
+	pack.names = data + hdr->names_offset;
+
+	return 1;
+invalid:
+	fprintf(stderr, "invalid pack '%s'\n", path);
+	file_unmap(data, size);
+	return 0;
+}
+
 int64_t
 file_size(const char *path)
 {
+	const struct pack_entry *e;
 	int64_t size;
 	FILE *f;
 
 	f = fopen(path, "rb");
-	if (f == NULL) {
+	if (f == NULL && (e = pack_find(path))) {
+		size = e->size;
+	} else if (f == NULL) {
 		fprintf(stderr, "fail to open '%s'\n", path);
 		size = -1;
 	} else {
@@ -42,12 +124,16 @@ file_size(const char *path)
 int64_t
 file_read(const char *path, void *buf, size_t size)
 {
+	const struct pack_entry *e;
 	int64_t ret = -1;
 	FILE *f;
 
 	if (buf) {
 		f = fopen(path, "rb");
-		if (f == NULL) {
+		if (f == NULL && (e = pack_find(path))) {
+			ret = MIN(size, e->size);
+			memcpy(buf, pack.data + e->offset, ret);
+		} else if (f == NULL) {
 			fprintf(stderr, "fail to open '%s'\n", path);
 			ret = -1;
 		} else {
@@ -75,5 +161,75 @@ file_time(const char *path)
 	if (path && stat(path, &sb) == 0)
 		return sb.st_ctime;
 #endif
+	if (pack_find(path))
+		return pack.time;
 	return 0;
 }
+
+/* read-only view of a whole file, NULL if missing or empty */
+void *
+file_map(const char *path, size_t *size)
+{
+	const struct pack_entry *e;
+#ifndef WINDOWS
+	struct stat sb;
+	void *addr;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		goto packed;
+	if (fstat(fd, &sb) < 0 || sb.st_size == 0) {
+		close(fd);
+		return NULL;
+	}
+	addr = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (addr == MAP_FAILED)
+		return NULL;
+	*size = sb.st_size;
+
+	return addr;
+#else
+	/* no mmap, read the file in a heap copy */
+	FILE *f = fopen(path, "rb");
+	int64_t len;
+	void *addr;
+
+	if (!f)
+		goto packed;
+	fclose(f);
+	len = file_size(path);
+	if (len <= 0)
+		return NULL;
+	addr = malloc(len);
+	if (!addr || file_read(path, addr, len) < 0) {
+		free(addr);
+		return NULL;
+	}
+	*size = len;
+
+	return addr;
+#endif
+packed:
+	/* served in place, file_unmap() leaves it alone */
+	e = pack_find(path);
+	if (!e || e->size == 0)
+		return NULL;
+	*size = e->size;
+
+	return pack.data + e->offset;
+}
+
+void
+file_unmap(void *addr, size_t size)
+{
+	if ((char *)addr >= pack.data && (char *)addr < pack.data + pack.size)
+		return;
+#ifndef WINDOWS
+	munmap(addr, size);
+#else
+	UNUSED(size);
+	free(addr);
+#endif
+}
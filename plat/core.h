@@ -11,4 +11,7 @@ void *xvmalloc(void *base, size_t align, size_t size);
 int64_t file_size(const char *path);
 int64_t file_read(const char *path, void *buf, size_t size);
 time_t file_time(const char *path);
+void *file_map(const char *path, size_t *size);
+void file_unmap(void *addr, size_t size);
+int pack_open(const char *path);
 
@@ -8,6 +8,7 @@ struct libgame {
 	game_init_t *init;
 	game_step_t *step;
 	game_fini_t *fini;
+	game_unload_t *unload;
 };
 
 void libgame_reload(struct libgame *libgame);
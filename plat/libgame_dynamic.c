@@ -2,11 +2,14 @@
 #include <dlfcn.h>
 #include "libgame.h"
 #include "core.h"
+#include "watch.h"
 
 #ifndef CONFIG_LIBDIR
 #define CONFIG_LIBDIR ""
 #endif
 
+static struct watch libgame_watch;
+
 void
 libgame_reload(struct libgame *libgame)
 {
@@ -16,6 +19,7 @@ libgame_reload(struct libgame *libgame)
 	libgame->init = NULL;
 	libgame->step = NULL;
 	libgame->fini = NULL;
+	libgame->unload = NULL;
 
 	if (libgame->handle) {
 		ret = dlclose(libgame->handle);
@@ -33,6 +37,7 @@ libgame_reload(struct libgame *libgame)
 		libgame->init = dlsym(libgame->handle, "game_init");
 		libgame->step = dlsym(libgame->handle, "game_step");
 		libgame->fini = dlsym(libgame->handle, "game_fini");
+		libgame->unload = dlsym(libgame->handle, "game_unload");
 		libgame->time = time;
 	}
 }
@@ -61,14 +66,20 @@ libgame_init(struct libgame *libgame)
 	libgame_reload(libgame);
 	if (!libgame->handle)
 		die("dlopen failed: %s\n", dlerror());
+
+	watch_init(&libgame_watch);
+	watch_add(&libgame_watch, libgame->path);
 }
 
 int
 libgame_changed(struct libgame *libgame)
 {
-	time_t new_time;
+	int changed = 0;
 
-	new_time = file_time(libgame->path);
+	UNUSED(libgame);
+	watch_poll(&libgame_watch);
+	while (watch_next(&libgame_watch))
+		changed = 1;
 
-	return libgame->time < new_time;
+	return changed;
 }
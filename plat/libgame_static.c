@@ -11,6 +11,7 @@ void libgame_init(struct libgame *libgame)
 	libgame->init = game_init;
 	libgame->step = game_step;
 	libgame->fini = game_fini;
+	libgame->unload = game_unload;
 }
 
 int libgame_changed(struct libgame *libgame)
@@ -0,0 +1,28 @@
+#pragma once
+
+/* Resource pack: one archive read in place by the file functions of
+ * plat/core.c, built from $(RES) by tools/pack. Layout, in native byte
+ * order: the header, the entries sorted by name, the NUL terminated
+ * names, then the file contents each aligned to PACK_ALIGN. */
+
+#include <stdint.h>
+
+#define PACK_MAGIC   0x4b434150 /* "PACK" */
+#define PACK_VERSION 1
+#define PACK_ALIGN   64
+#define PACK_FILE    "res.pack"
+
+struct pack_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t count;
+	uint32_t names_size;
+	uint64_t names_offset;
+};
+
+struct pack_entry {
+	uint32_t name; /* offset in the names */
+	uint32_t pad;
+	uint64_t offset; /* from the start of the pack */
+	uint64_t size;
+};
@@ -0,0 +1,161 @@
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+#include "plat/core.h"
+#include "plat/watch.h"
+
+#ifdef __linux__
+#define WATCH_EVENTS (IN_CLOSE_WRITE | IN_MOVED_TO | IN_ATTRIB)
+#endif
+
+void
+watch_init(struct watch *w)
+{
+	w->fd = -1;
+	w->polled = 0;
+	w->count = 0;
+	w->head = 0;
+	w->tail = 0;
+#ifdef __linux__
+	w->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (w->fd < 0)
+		warn("inotify: %s, polling files instead\n", strerror(errno));
+#endif
+}
+
+void
+watch_fini(struct watch *w)
+{
+	if (w->fd >= 0)
+		close(w->fd);
+	w->fd = -1;
+	w->count = 0;
+}
+
+static void
+watch_push(struct watch *w, size_t i)
+{
+	if (w->entries[i].pending)
+		return;
+	w->entries[i].pending = 1;
+	w->queue[w->head++ % WATCH_MAX] = i;
+}
+
+/* The directory is watched rather than the file, editors and linkers
+ * replace files and an inode watch would be lost. Paths are copied, the
+ * caller may be unloaded. Return 0 on failure. */
+int
+watch_add(struct watch *w, const char *path)
+{
+	struct watch_entry *e;
+	char *slash;
+	size_t i;
+
+	if (!path)
+		return 0;
+	for (i = 0; i < w->count; i++)
+		if (strcmp(w->entries[i].path, path) == 0)
+			return 1;
+	if (w->count == WATCH_MAX || strlen(path) >= WATCH_PATH) {
+		warn("watch: can't watch %s\n", path);
+		return 0;
+	}
+
+	e = &w->entries[w->count++];
+	strcpy(e->path, path);
+	e->pending = 0;
+	e->time = file_time(path);
+	e->wd = -1;
+	e->name = e->path;
+
+	slash = strrchr(e->path, '/');
+	if (slash)
+		e->name = slash + 1;
+#ifdef __linux__
+	if (w->fd >= 0) {
+		if (slash)
+			*slash = '\0';
+		e->wd = inotify_add_watch(w->fd, slash ? e->path : ".", WATCH_EVENTS);
+		if (slash)
+			*slash = '/';
+	}
+#endif
+
+	return 1;
+}
+
+#ifdef __linux__
+static void
+watch_read(struct watch *w)
+{
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	const struct inotify_event *ev;
+	ssize_t len;
+	char *p;
+	size_t i;
+
+	while ((len = read(w->fd, buf, sizeof(buf))) > 0) {
+		for (p = buf; p < buf + len; p += sizeof(*ev) + ev->len) {
+			ev = (const struct inotify_event *)p;
+			if (ev->mask & IN_Q_OVERFLOW) {
+				/* events were lost, assume everything changed */
+				for (i = 0; i < w->count; i++)
+					watch_push(w, i);
+				continue;
+			}
+			if (!ev->len)
+				continue;
+			for (i = 0; i < w->count; i++)
+				if (w->entries[i].wd == ev->wd && strcmp(w->entries[i].name, ev->name) == 0)
+					watch_push(w, i);
+		}
+	}
+}
+#endif
+
+/* once per frame: queue the paths changed since the last call */
+void
+watch_poll(struct watch *w)
+{
+	time_t now = time(NULL);
+	time_t t;
+	size_t i;
+
+#ifdef __linux__
+	if (w->fd >= 0)
+		watch_read(w);
+#endif
+
+	/* file times have a one second resolution, don't stat more often */
+	if (now == w->polled)
+		return;
+	w->polled = now;
+
+	for (i = 0; i < w->count; i++) {
+		if (w->entries[i].wd >= 0)
+			continue;
+		t = file_time(w->entries[i].path);
+		if (t > w->entries[i].time) {
+			w->entries[i].time = t;
+			watch_push(w, i);
+		}
+	}
+}
+
+/* next changed path, NULL once the queue is empty */
+const char *
+watch_next(struct watch *w)
+{
+	struct watch_entry *e;
+
+	if (w->tail == w->head)
+		return NULL;
+
+	e = &w->entries[w->queue[w->tail++ % WATCH_MAX]];
+	e->pending = 0;
+
+	return e->path;
+}
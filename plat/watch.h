@@ -0,0 +1,31 @@
+#pragma once
+
+#include <time.h>
+
+/* File change notifications: inotify on Linux, stat() polling elsewhere
+ * or when a directory cannot be watched. Changed paths are queued by
+ * watch_poll() and drained with watch_next(). */
+
+#define WATCH_MAX  64
+#define WATCH_PATH 128
+
+struct watch {
+	int fd; /* inotify descriptor, -1 when polling */
+	time_t polled; /* last stat() pass */
+	size_t count;
+	struct watch_entry {
+		char path[WATCH_PATH];
+		const char *name; /* basename, inside path */
+		int wd; /* directory watch, -1 when polled */
+		int pending;
+		time_t time;
+	} entries[WATCH_MAX];
+	size_t head, tail;
+	unsigned char queue[WATCH_MAX]; /* index of the pending entries */
+};
+
+void watch_init(struct watch *w);
+void watch_fini(struct watch *w);
+int watch_add(struct watch *w, const char *path);
+void watch_poll(struct watch *w);
+const char *watch_next(struct watch *w);
@@ -0,0 +1,6 @@
+#version 330 core
+
+/* depth only, nothing to shade */
+void main(void)
+{
+}
@@ -0,0 +1,12 @@
+#version 330 core
+
+in vec3 in_pos;
+in mat4 in_model;
+
+uniform mat4 proj;
+uniform mat4 view;
+
+void main(void)
+{
+	gl_Position = proj * view * in_model * vec4(in_pos, 1.0);
+}
@@ -5,8 +5,6 @@ in vec2 in_texcoord;
 out vec3 normal;
 out vec2 texcoord;
 uniform mat4 model;
-uniform mat4 lsview;
-uniform mat4 lsproj;
 uniform vec2 v2Resolution;
 
 void main(void)
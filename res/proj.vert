@@ -3,25 +3,20 @@
 in vec3 in_pos;
 in vec3 in_normal;
 in vec2 in_texcoord;
+in mat4 in_model;
 out vec3 normal;
 out vec3 position;
 out vec2 texcoord;
-out vec4 shadowpos;
 
 uniform mat4 proj;
 uniform mat4 view;
-uniform mat4 model;
-uniform mat4 lsview;
-uniform mat4 lsproj;
 
 void main(void)
 {
-	vec4 pos = model * vec4(in_pos, 1.0);
+	vec4 pos = in_model * vec4(in_pos, 1.0);
 
 	gl_Position = proj * view * pos;
-	shadowpos = lsproj * lsview * pos;
-//	shadowpos.xyz = 0.5 + 0.5 * (shadowpos.xyz / shadowpos.w);
 	position = pos.xyz;
 	texcoord = in_texcoord;
-	normal = transpose(inverse(mat3(model))) * in_normal;
+	normal = transpose(inverse(mat3(in_model))) * in_normal;
 }
@@ -5,7 +5,6 @@ precision highp int;
 in vec3 normal;
 in vec2 texcoord;
 in vec3 position;
-in vec4 shadowpos;
 
 out vec4 out_color;
 uniform vec3 lightd;
@@ -16,29 +15,47 @@ uniform vec3 color;
 const float fog_density = 0.005;
 const vec3 fog_color = vec3(0.05,0.1,0.1);
 
-#if 0
-uniform sampler2DShadow shadowmap;
-float shadowlookup(vec4 coord, vec2 uv)
-{
-	vec2 off = uv / vec2(textureSize(shadowmap, 0));
-//	return texture(shadowmap, coord.xyz, + vec3(off, - 0.00001));
-	return texture(shadowmap, coord.xyz, 0* 0.01);
-}
-#else
-uniform sampler2D shadowmap;
-float shadowlookup(vec4 coord, vec2 uv)
+/* SHADOW_CASCADES is defined by the loader from game/render.h */
+#ifndef SHADOW_CASCADES
+#error "SHADOW_CASCADES is not defined"
+#elif SHADOW_CASCADES > 3
+#error "shadowlookup() handles up to 3 cascades"
+#endif
+uniform mat4 lsmat[SHADOW_CASCADES];
+uniform float cascade_far[SHADOW_CASCADES];
+/* constant and per slope depth bias of each cascade */
+uniform vec2 cascade_bias[SHADOW_CASCADES];
+uniform sampler2D shadowmap[SHADOW_CASCADES];
+
+/* sampler arrays can only be indexed by constants */
+float shadowlookup(int i, vec2 uv)
 {
-	vec2 off = uv / vec2(textureSize(shadowmap, 0));
-	float d = coord.z + 0.00001;
-	float s = texture(shadowmap, coord.xy + off).z;
-	return (s <= d) ? 0.0: 1.0;
-}
+#if SHADOW_CASCADES > 1
+	if (i == 1)
+		return texture(shadowmap[1], uv).r;
 #endif
-float shadow(void)
+#if SHADOW_CASCADES > 2
+	if (i == 2)
+		return texture(shadowmap[2], uv).r;
+#endif
+	return texture(shadowmap[0], uv).r;
+}
+
+/* inc is the cosine between the normal and the light */
+bool shadow(float depth, float inc)
 {
-	float shadow = 0.0;
-	return shadowlookup(shadowpos, vec2(0));
+	int i = 0;
+	while (i < SHADOW_CASCADES - 1 && depth >= cascade_far[i])
+		i++;
+	vec4 s = lsmat[i] * vec4(position, 1.0);
+	vec3 p = 0.5 + 0.5 * (s.xyz / s.w);
+	float c = clamp(-inc, 0.001, 1.0);
+	float slope = min(sqrt(1.0 - c * c) / c, 4.0);
+	float bias = cascade_bias[i].x + cascade_bias[i].y * slope;
+
+	return p.z > shadowlookup(i, p.xy) - bias;
 }
+
 void main(void)
 {
 	const vec3 sky_color = vec3(0.324, 0.0420, 0.0178);
@@ -48,9 +65,7 @@ void main(void)
 	float z = gl_FragCoord.z / gl_FragCoord.w;
 	float fog = exp(-fog_density * z * z);
 
-	vec3 p = 0.5 + 0.5 * (shadowpos.xyz / shadowpos.w);
-	float dep = texture(shadowmap, p.xy).r;
-	bool inshadow = p.z > (dep - 0.000001) || inc > 0.0;
+	bool inshadow = inc > 0.0 || shadow(1.0 / gl_FragCoord.w, inc);
 
 	col = mix(col, col+vec3(0.2,0.1,0.15)*0.5, 1.0- dot(normal, vec3(0,1,0)));
 	if (inshadow)
@@ -3,3 +3,4 @@ LIBDIR = lib32
 CFLAGS += -m32
 LDFLAGS += -m32
 LDFLAGS += -L$(LIBDIR) -Wl,-rpath=./$(LIBDIR) -rdynamic
+LDFLAGS += -lpthread
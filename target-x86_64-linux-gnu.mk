@@ -2,3 +2,4 @@ LIBDIR = lib64
 CFLAGS += -m64
 LDFLAGS += -m64
 LDFLAGS += -L$(LIBDIR) -Wl,-rpath=./$(LIBDIR) -rdynamic
+LDFLAGS += -lpthread
@@ -0,0 +1,208 @@
+/* bench-audio: mix voices the way do_audio() does, one sample per
+ * step_sampler() call as before and by SOUND_BLOCK with sound_render(),
+ * report the cost per voice and frame and check the output agrees */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "core/util.h"
+#include "core/math.h"
+#include "core/sampler.h"
+#include "core/wav.h"
+#include "game/sound.h"
+
+#define VOICES  16
+#define FRAMES  1024 /* frames per audio callback */
+#define ROUNDS  200
+#define SAMPLES 48000 /* one second of stereo at 24kHz */
+
+static double
+now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* step_sampler() as it was before sampler_render(), without streams */
+static sample
+step_sampler_ref(struct sampler *s)
+{
+	int16_t *samples;
+	sample ret = 0;
+
+	if (s->trig) {
+		s->trig = 0;
+		switch (s->state) {
+		case PLAY:
+			s->cur = s->beg;
+			break;
+		case STOP:
+			s->state = PLAY;
+			break;
+		}
+	}
+	if (s->cur >= s->wav->extras.nb_samples) {
+		if (s->loop) {
+			s->cur = s->loop_beg;
+		} else {
+			s->state = STOP;
+			s->cur = s->beg;
+		}
+	}
+	if (s->state == PLAY) {
+		samples = (int16_t *) s->wav->audio_data;
+		ret = s->vol * (float) (samples[s->cur++] / (float) INT16_MAX);
+	}
+
+	return ret;
+}
+
+static struct listener
+listener_lerp(struct listener a, struct listener b, float x)
+{
+	struct listener r;
+
+	r.pos = vec3_lerp(a.pos, b.pos, x);
+	r.dir = vec3_lerp(a.dir, b.dir, x);
+	r.left = vec3_lerp(a.left, b.left, x);
+
+	return r;
+}
+
+/* the per frame panning of sound_pos_step() */
+static struct frame
+pan_ref(struct sound *s, struct listener *li, struct frame f)
+{
+	vec3 v = vec3_normalize(vec3_sub(s->pos, li->pos));
+	float sin = vec3_dot(li->left, v);
+	float c = ABS(vec3_dot(li->dir, v));
+	float vol = 1 / vec3_norm(vec3_sub(li->pos, s->pos));
+
+	f.l = (f.l * MAX(0, sin) + f.l * c) * vol;
+	f.r = (f.r * ABS(MIN(0, sin)) + f.r * c) * vol;
+
+	return f;
+}
+
+/* do_audio() before block rendering */
+static void
+mix_step(struct sound *sounds, struct listener cur, struct listener nxt, struct frame *out)
+{
+	struct listener lis;
+	struct frame f;
+	size_t i, j;
+	float x;
+
+	memset(out, 0, FRAMES * sizeof(*out));
+	for (i = 0; i < VOICES; i++) {
+		for (j = 0; j < FRAMES; j++) {
+			x = j / (float)FRAMES;
+			f.l = step_sampler_ref(&sounds[i].sampler);
+			f.r = step_sampler_ref(&sounds[i].sampler);
+			if (sound_is_positional(&sounds[i])) {
+				lis = listener_lerp(cur, nxt, x);
+				f = pan_ref(&sounds[i], &lis, f);
+			}
+			out[j].l += f.l * mix(0.5, 1, x);
+			out[j].r += f.r * mix(0.5, 1, x);
+		}
+	}
+}
+
+/* do_audio() now */
+static void
+mix_block(struct sound *sounds, struct listener cur, struct listener nxt, struct frame *out)
+{
+	struct frame f[SOUND_BLOCK];
+	struct listener lis0, lis1;
+	size_t i, j, n;
+	float x0, x1;
+
+	memset(out, 0, FRAMES * sizeof(*out));
+	for (i = 0; i < VOICES; i++) {
+		for (j = 0; j < FRAMES; j += n) {
+			n = MIN(FRAMES - j, SOUND_BLOCK);
+			x0 = j / (float)FRAMES;
+			x1 = (j + n) / (float)FRAMES;
+			if (sound_is_positional(&sounds[i])) {
+				lis0 = listener_lerp(cur, nxt, x0);
+				lis1 = listener_lerp(cur, nxt, x1);
+				sound_pos_render(&sounds[i], &lis0, &lis1, f, n);
+			} else {
+				sound_render(&sounds[i], f, n);
+			}
+			sound_mix(out + j, f, n);
+		}
+	}
+	sound_volume(out, FRAMES, mix(0.5, 1, 0), mix(0.5, 1, 1));
+}
+
+static void
+init_sounds(struct sound *sounds, struct wav *wav)
+{
+	vec3 pos;
+	size_t i;
+
+	for (i = 0; i < VOICES; i++) {
+		pos = (vec3){ i * 1.5 - 10, 0, 5 };
+		/* every other voice is positional, starts shifted */
+		sound_init(&sounds[i], wav, LOOP, TRIG, i & 1, pos);
+		sounds[i].sampler.cur = i * 1000;
+	}
+}
+
+int
+main(void)
+{
+	struct listener cur = {
+		.pos = { 0, 0, 0 }, .dir = { 0, 0, 1 }, .left = { 1, 0, 0 },
+	};
+	struct listener nxt = {
+		.pos = { 0.5, 0, 0.5 }, .dir = { 0, 0, 1 }, .left = { 1, 0, 0 },
+	};
+	static struct sound step[VOICES], block[VOICES];
+	static struct frame out_step[FRAMES], out_block[FRAMES];
+	static int16_t data[SAMPLES];
+	struct wav wav = { 0 };
+	double start, t_step, t_block, err = 0, d;
+	size_t i;
+	int round;
+
+	for (i = 0; i < SAMPLES; i++)
+		data[i] = (int16_t)(i * 7919);
+	wav.header.channels = 2;
+	wav.extras.nb_samples = SAMPLES;
+	wav.audio_data = data;
+
+	init_sounds(step, &wav);
+	init_sounds(block, &wav);
+	for (round = 0; round < 4; round++) {
+		mix_step(step, cur, nxt, out_step);
+		mix_block(block, cur, nxt, out_block);
+		for (i = 0; i < FRAMES; i++) {
+			d = ABS(out_step[i].l - out_block[i].l) + ABS(out_step[i].r - out_block[i].r);
+			err = MAX(err, d);
+		}
+	}
+
+	start = now();
+	for (round = 0; round < ROUNDS; round++)
+		mix_step(step, cur, nxt, out_step);
+	t_step = (now() - start) * 1e9 / ((double)ROUNDS * VOICES * FRAMES);
+	start = now();
+	for (round = 0; round < ROUNDS; round++)
+		mix_block(block, cur, nxt, out_block);
+	t_block = (now() - start) * 1e9 / ((double)ROUNDS * VOICES * FRAMES);
+
+	printf("%d voices, %d frames per callback, blocks of %d\n", VOICES, FRAMES, SOUND_BLOCK);
+	printf("step   %6.2f ns per voice and frame\n", t_step);
+	printf("block  %6.2f ns per voice and frame, %.1fx\n", t_block, t_step / t_block);
+	printf("max difference %.2e\n", err);
+
+	/* the panning ramps per block instead of per frame */
+	return err > 1e-2;
+}
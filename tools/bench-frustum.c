@@ -0,0 +1,98 @@
+/* bench-frustum: time the scalar, SSE and AVX paths of
+ * spheres_in_frustum() on a fixed sphere set, check they agree */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "core/util.h"
+#include "core/math.h"
+
+#define SPHERES 100000
+#define ROUNDS  200
+
+static const char *impl_name[] = {
+	[FRUSTUM_SCALAR] = "scalar",
+	[FRUSTUM_SSE] = "sse",
+	[FRUSTUM_AVX] = "avx",
+};
+
+static double
+now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* deterministic, the set is the same on every run */
+static float
+rnd(unsigned int *seed, float min, float max)
+{
+	*seed = *seed * 1103515245 + 12345;
+	return min + (max - min) * ((*seed >> 8) & 0xffff) / 65535.0;
+}
+
+int
+main(void)
+{
+	/* a tilted box, about half of the spheres are inside */
+	vec4 planes[6] = {
+		{ .x =  1, .y = 0.2, .z = 0, .w = 10 },
+		{ .x = -1, .y = 0.2, .z = 0, .w = 10 },
+		{ .x = 0, .y =  1, .z = 0.1, .w = 10 },
+		{ .x = 0, .y = -1, .z = 0.1, .w = 10 },
+		{ .x = 0.3, .y = 0, .z =  1, .w = 10 },
+		{ .x = 0.3, .y = 0, .z = -1, .w = 10 },
+	};
+	size_t words = (SPHERES + 31) / 32;
+	float *x, *y, *z, *r;
+	uint32_t *ref, *visible;
+	unsigned int seed = 1;
+	size_t i, n;
+	double start, ns;
+	int impl, round, errors = 0;
+
+	x = malloc(SPHERES * sizeof(*x));
+	y = malloc(SPHERES * sizeof(*y));
+	z = malloc(SPHERES * sizeof(*z));
+	r = malloc(SPHERES * sizeof(*r));
+	ref = malloc(words * sizeof(*ref));
+	visible = malloc(words * sizeof(*visible));
+	if (!x || !y || !z || !r || !ref || !visible)
+		die("bench-frustum: out of memory\n");
+	for (i = 0; i < SPHERES; i++) {
+		x[i] = rnd(&seed, -20, 20);
+		y[i] = rnd(&seed, -20, 20);
+		z[i] = rnd(&seed, -20, 20);
+		r[i] = rnd(&seed, 0, 2);
+	}
+
+	spheres_in_frustum_use(FRUSTUM_SCALAR);
+	spheres_in_frustum(planes, x, y, z, r, SPHERES, ref);
+	for (i = n = 0; i < SPHERES; i++)
+		n += (ref[i / 32] >> (i % 32)) & 1;
+	printf("%d spheres, %zu visible\n", SPHERES, n);
+
+	for (impl = FRUSTUM_SCALAR; impl <= FRUSTUM_AVX; impl++) {
+		if (!spheres_in_frustum_use(impl)) {
+			printf("%-8s unsupported\n", impl_name[impl]);
+			continue;
+		}
+		start = now();
+		for (round = 0; round < ROUNDS; round++)
+			spheres_in_frustum(planes, x, y, z, r, SPHERES, visible);
+		ns = (now() - start) * 1e9 / ((double)SPHERES * ROUNDS);
+
+		if (memcmp(ref, visible, words * sizeof(*ref)) != 0) {
+			printf("%-8s %6.2f ns/sphere, MISMATCH\n", impl_name[impl], ns);
+			errors++;
+		} else {
+			printf("%-8s %6.2f ns/sphere\n", impl_name[impl], ns);
+		}
+	}
+
+	return errors != 0;
+}
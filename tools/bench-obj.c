@@ -0,0 +1,130 @@
+/* bench-obj: time obj_load() on a generated grid of over a million
+ * faces, or on the given obj files, and report the zone it used */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "core/util.h"
+#include "core/math.h"
+#include "core/obj.h"
+
+#define GRID   720 /* quads per side, two triangles each */
+#define ROUNDS 5
+
+static double
+now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* a bumpy grid with positions, texcoords and normals like an exported
+ * prop, every vertex is shared by several faces */
+static char *
+gen_grid(size_t *size)
+{
+	/* at most 96 bytes for the v, vt and vn lines of a vertex and 80
+	 * for a face line */
+	size_t cap = (size_t)(GRID + 1) * (GRID + 1) * 96 + (size_t)GRID * GRID * 2 * 80;
+	char *data = malloc(cap), *p = data;
+	int i, j, a, b, c, d;
+
+	if (!data)
+		die("bench-obj: out of memory\n");
+	for (j = 0; j <= GRID; j++)
+		for (i = 0; i <= GRID; i++)
+			p += sprintf(p, "v %.6f %.6f %.6f\n", i * 0.1, sin(i * 0.3) * cos(j * 0.2), j * 0.1);
+	for (j = 0; j <= GRID; j++)
+		for (i = 0; i <= GRID; i++)
+			p += sprintf(p, "vt %.6f %.6f\n", i / (float)GRID, j / (float)GRID);
+	for (j = 0; j <= GRID; j++)
+		for (i = 0; i <= GRID; i++)
+			p += sprintf(p, "vn %.6f %.6f %.6f\n", 0.0, 1.0, 0.0);
+	for (j = 0; j < GRID; j++) {
+		for (i = 0; i < GRID; i++) {
+			a = j * (GRID + 1) + i + 1;
+			b = a + 1;
+			c = a + GRID + 1;
+			d = c + 1;
+			p += sprintf(p, "f %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, b, b, b, d, d, d);
+			p += sprintf(p, "f %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, d, d, d, c, c, c);
+		}
+	}
+	*size = p - data;
+
+	return data;
+}
+
+static char *
+read_file(const char *path, size_t *size)
+{
+	char *data;
+	long len;
+	FILE *f;
+
+	f = fopen(path, "rb");
+	if (!f)
+		die("bench-obj: fail to open '%s'\n", path);
+	fseek(f, 0, SEEK_END);
+	len = ftell(f);
+	rewind(f);
+	data = malloc(len > 0 ? len : 1);
+	if (!data || fread(data, 1, len, f) != (size_t)len)
+		die("bench-obj: fail to read '%s'\n", path);
+	fclose(f);
+	*size = len;
+
+	return data;
+}
+
+static void
+bench(const char *name, const char *data, size_t size)
+{
+	/* same bound as meshc */
+	size_t zone_size = size * 16 + SZ_16M;
+	struct memory_zone zone = memory_zone_init(malloc(zone_size), zone_size);
+	struct obj_mesh obj;
+	double start, best = 0, t;
+	int round;
+
+	if (!zone.base)
+		die("bench-obj: out of memory\n");
+	for (round = 0; round < ROUNDS; round++) {
+		zone.used = 0;
+		start = now();
+		obj = obj_load(&zone, data, size);
+		t = now() - start;
+		if (!round || t < best)
+			best = t;
+	}
+
+	printf("%s: %.1f MB, %zu faces, %zu vertices, %.1f ms, %.1f MB/s, zone %.2fx the file\n",
+	       name, size / 1e6, obj.index_count / 3, obj.vertex_count, best * 1e3,
+	       size / 1e6 / best, zone.used / (double)size);
+	free(zone.base);
+}
+
+int
+main(int argc, char *argv[])
+{
+	size_t size;
+	char *data;
+	int i;
+
+	if (argc < 2) {
+		data = gen_grid(&size);
+		bench("grid", data, size);
+		free(data);
+	}
+	for (i = 1; i < argc; i++) {
+		data = read_file(argv[i], &size);
+		bench(argv[i], data, size);
+		free(data);
+	}
+
+	return 0;
+}
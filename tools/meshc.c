@@ -0,0 +1,133 @@
+/* meshc: bake a wavefront obj into the mesh file read by MESH_BIN assets,
+ * see struct mesh_file_header */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "plat/glad.h"
+#include "core/util.h"
+#include "core/math.h"
+#include "core/obj.h"
+#include "core/meshdata.h"
+
+static void
+usage(void)
+{
+	die("usage: meshc [-h] -o out.mesh in.obj\n"
+	    "  -h  store positions as half floats\n");
+}
+
+static char *
+read_file(const char *path, size_t *size)
+{
+	char *data;
+	long len;
+	FILE *f;
+
+	f = fopen(path, "rb");
+	if (!f)
+		die("meshc: fail to open '%s'\n", path);
+	fseek(f, 0, SEEK_END);
+	len = ftell(f);
+	rewind(f);
+	data = malloc(len > 0 ? len : 1);
+	if (!data || fread(data, 1, len, f) != (size_t)len)
+		die("meshc: fail to read '%s'\n", path);
+	fclose(f);
+	*size = len;
+
+	return data;
+}
+
+static void
+write_blob(FILE *f, const void *data, size_t size, uint64_t offset)
+{
+	static const char zero[16];
+	long pad = offset - ftell(f);
+
+	if (pad < 0 || pad > (long)sizeof(zero))
+		die("meshc: bad blob offset\n");
+	if (fwrite(zero, 1, pad, f) != (size_t)pad || fwrite(data, 1, size, f) != size)
+		die("meshc: write error\n");
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct mesh_file_header hdr;
+	struct memory_zone zone;
+	struct obj_mesh obj;
+	const char *in = NULL, *out = NULL;
+	unsigned int flags = MESH_INTERLEAVED;
+	size_t size, zone_size, vsize, isize, i;
+	void *vertices, *indices;
+	char *data;
+	FILE *f;
+
+	for (i = 1; i < (size_t)argc; i++) {
+		if (strcmp(argv[i], "-h") == 0)
+			flags |= MESH_HALF_POSITION;
+		else if (strcmp(argv[i], "-o") == 0 && i + 1 < (size_t)argc)
+			out = argv[++i];
+		else if (argv[i][0] != '-' && !in)
+			in = argv[i];
+		else
+			usage();
+	}
+	if (!in || !out)
+		usage();
+
+	data = read_file(in, &size);
+	/* parsed lists and welded vertices are a few times the text size */
+	zone_size = size * 16 + SZ_16M;
+	zone = memory_zone_init(malloc(zone_size), zone_size);
+	if (!zone.base)
+		die("meshc: out of memory\n");
+
+	obj = obj_load(&zone, data, size);
+	if (obj.index_count == 0)
+		die("meshc: %s: no face\n", in);
+	mesh_optimize_index(&zone, obj.indices, obj.index_count, obj.vertex_count, MESH_CACHE_SIZE);
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic = MESH_FILE_MAGIC;
+	hdr.version = MESH_FILE_VERSION;
+	hdr.primitive = GL_TRIANGLES;
+	hdr.vertex_count = obj.vertex_count;
+	hdr.index_count = obj.index_count;
+	hdr.index_size = obj.vertex_count <= 0x10000 ? sizeof(uint16_t) : sizeof(uint32_t);
+	hdr.format = mesh_vertex_format(flags, obj.normals != NULL, obj.texcoords != NULL);
+	hdr.bounding = mesh_bounding_volume(obj.vertex_count, obj.positions);
+
+	vsize = obj.vertex_count * hdr.format.stride;
+	vertices = mempush(&zone, vsize);
+	mesh_pack_vertices(&hdr.format, obj.vertex_count, obj.positions,
+			   obj.normals, obj.texcoords, vertices);
+
+	isize = obj.index_count * hdr.index_size;
+	indices = obj.indices;
+	if (hdr.index_size == sizeof(uint16_t)) {
+		uint16_t *narrow = mempush(&zone, isize);
+		for (i = 0; i < obj.index_count; i++)
+			narrow[i] = obj.indices[i];
+		indices = narrow;
+	}
+
+	/* blobs are 16 bytes aligned */
+	hdr.vertex_offset = (sizeof(hdr) + 15) & ~15;
+	hdr.index_offset = (hdr.vertex_offset + vsize + 15) & ~15;
+
+	f = fopen(out, "wb");
+	if (!f)
+		die("meshc: fail to open '%s'\n", out);
+	write_blob(f, &hdr, sizeof(hdr), 0);
+	write_blob(f, vertices, vsize, hdr.vertex_offset);
+	write_blob(f, indices, isize, hdr.index_offset);
+	if (fclose(f) != 0)
+		die("meshc: write error\n");
+
+	printf("%s: %zu vertices, %zu indices, %u bytes stride\n",
+	       out, obj.vertex_count, obj.index_count, hdr.format.stride);
+
+	return 0;
+}
@@ -0,0 +1,123 @@
+/* pack: build the resource pack read by plat/core.c, see plat/pack.h */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "plat/pack.h"
+
+struct file {
+	const char *name;
+	char *data;
+	size_t size;
+};
+
+static void
+die(const char *msg, const char *arg)
+{
+	fprintf(stderr, "pack: %s '%s'\n", msg, arg);
+	exit(1);
+}
+
+static int
+file_cmp(const void *a, const void *b)
+{
+	return strcmp(((struct file *)a)->name, ((struct file *)b)->name);
+}
+
+static void
+read_file(struct file *file)
+{
+	long len;
+	FILE *f;
+
+	f = fopen(file->name, "rb");
+	if (!f)
+		die("fail to open", file->name);
+	fseek(f, 0, SEEK_END);
+	len = ftell(f);
+	rewind(f);
+	file->data = malloc(len > 0 ? len : 1);
+	if (!file->data || fread(file->data, 1, len, f) != (size_t)len)
+		die("fail to read", file->name);
+	fclose(f);
+	file->size = len;
+}
+
+static void
+write_at(FILE *f, const void *data, size_t size, uint64_t offset, const char *out)
+{
+	static const char zero[PACK_ALIGN];
+	long pad = offset - ftell(f);
+
+	if (pad < 0 || pad > PACK_ALIGN)
+		die("bad offset writing", out);
+	if (fwrite(zero, 1, pad, f) != (size_t)pad || fwrite(data, 1, size, f) != size)
+		die("fail to write", out);
+}
+
+static uint64_t
+align(uint64_t x)
+{
+	return (x + PACK_ALIGN - 1) & ~(uint64_t)(PACK_ALIGN - 1);
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct pack_header hdr = { 0 };
+	struct pack_entry *entries;
+	struct file *files;
+	const char *out;
+	uint64_t offset;
+	size_t count, i;
+	FILE *f;
+
+	if (argc < 3 || strcmp(argv[1], "-o") != 0) {
+		fprintf(stderr, "usage: pack -o out.pack files...\n");
+		return 1;
+	}
+	out = argv[2];
+	count = argc - 3;
+
+	files = calloc(count, sizeof(*files));
+	entries = calloc(count, sizeof(*entries));
+	if ((count && !files) || (count && !entries))
+		die("out of memory for", out);
+	for (i = 0; i < count; i++) {
+		files[i].name = argv[i + 3];
+		read_file(&files[i]);
+	}
+	/* entries are looked up with a binary search */
+	qsort(files, count, sizeof(*files), file_cmp);
+
+	hdr.magic = PACK_MAGIC;
+	hdr.version = PACK_VERSION;
+	hdr.count = count;
+	hdr.names_offset = sizeof(hdr) + count * sizeof(*entries);
+	for (i = 0; i < count; i++) {
+		entries[i].name = hdr.names_size;
+		hdr.names_size += strlen(files[i].name) + 1;
+	}
+	offset = align(hdr.names_offset + hdr.names_size);
+	for (i = 0; i < count; i++) {
+		entries[i].offset = offset;
+		entries[i].size = files[i].size;
+		offset = align(offset + files[i].size);
+	}
+
+	f = fopen(out, "wb");
+	if (!f)
+		die("fail to open", out);
+	write_at(f, &hdr, sizeof(hdr), 0, out);
+	write_at(f, entries, count * sizeof(*entries), sizeof(hdr), out);
+	for (i = 0; i < count; i++)
+		write_at(f, files[i].name, strlen(files[i].name) + 1, ftell(f), out);
+	for (i = 0; i < count; i++)
+		write_at(f, files[i].data, files[i].size, entries[i].offset, out);
+	if (fclose(f) != 0)
+		die("fail to write", out);
+
+	printf("%s: %zu files\n", out, count);
+
+	return 0;
+}